@@ -0,0 +1,633 @@
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "chatHistogram.h"
+#include "chatProtocol.h"
+
+#define PORT 8080
+#define MAX_EVENTS 256
+
+// Awal setiap pesan benchmark: waktu kirim (ns, CLOCK_MONOTONIC), id pengirim, nomor urut
+#define BENCH_STAMP_SIZE 16
+
+// Waktu tunggu setelah semua klien login sebelum mulai mengirim, dan batas
+// waktu menunggu pesan yang masih di jalan setelah pengiriman selesai
+#define BENCH_SETTLE_MS 200
+#define BENCH_DRAIN_MS 2000
+
+enum bench_state {
+    BENCH_CONNECTING,
+    BENCH_OPEN,
+    BENCH_CLOSED
+};
+
+// Satu klien simulasi. Semua klien berbagi satu event loop epoll.
+struct bench_client {
+    int fd;
+    int id;
+    enum bench_state state;
+    uint64_t connect_start;
+    struct chat_parser parser;
+    // Sisa data yang belum terkirim karena socket penuh
+    char *pending;
+    size_t pending_len;
+    size_t pending_capacity;
+};
+
+struct bench_config {
+    const char *host;
+    int port;
+    int clients;
+    int connect_rate;  // koneksi baru per detik
+    int senders;       // jumlah klien yang mengirim pesan
+    double msg_rate;   // total pesan per detik dari semua pengirim
+    size_t msg_size;   // ukuran teks pesan dalam byte
+    double duration;   // lama fase pengiriman dalam detik
+    const char *room;  // room tujuan (NULL = room default server)
+    int json;
+};
+
+struct bench_stats {
+    uint64_t connected;
+    uint64_t connect_failed;
+    uint64_t rejected;  // koneksi yang ditolak server dengan frame REJECT
+    uint64_t disconnected;
+    long listen_drops;  // SYN/koneksi yang dibuang antrian listen di host selama ramp-up, -1 jika tidak diketahui
+    uint64_t sent;
+    uint64_t skipped;   // jadwal kirim yang dilewati karena socket pengirim masih penuh
+    uint64_t throttled; // frame THROTTLE dari server (pesan pengirim dibuang batas laju)
+    uint64_t received;
+    uint64_t bytes_received;
+    uint64_t send_start;
+    uint64_t send_end;
+    uint64_t last_receive;
+    struct chat_histogram connect_latency;
+    struct chat_histogram latency;
+};
+
+struct bench_config config;
+struct bench_stats stats;
+
+uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+double ns_to_ms(uint64_t ns) {
+    return (double)ns / 1e6;
+}
+
+// Menaikkan batas file descriptor ke batas keras agar ribuan klien muat dalam satu proses
+void raise_fd_limit(void) {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+// Counter TcpExt ListenDrops dari /proc/net/netstat (seluruh host): koneksi
+// yang dibuang karena antrian SYN atau antrian accept penuh. -1 jika tidak ada.
+long read_listen_drops(void) {
+    FILE *f = fopen("/proc/net/netstat", "r");
+    if (f == NULL) {
+        return -1;
+    }
+    char names[4096], values[4096];
+    long result = -1;
+    while (result < 0 && fgets(names, sizeof(names), f) != NULL && fgets(values, sizeof(values), f) != NULL) {
+        if (strncmp(names, "TcpExt:", 7) != 0) {
+            continue;
+        }
+        // Baris pertama berisi nama kolom, baris kedua nilainya
+        char *name_save, *value_save;
+        char *name = strtok_r(names, " \n", &name_save);
+        char *value = strtok_r(values, " \n", &value_save);
+        while (name != NULL && value != NULL) {
+            if (strcmp(name, "ListenDrops") == 0) {
+                result = atol(value);
+                break;
+            }
+            name = strtok_r(NULL, " \n", &name_save);
+            value = strtok_r(NULL, " \n", &value_save);
+        }
+    }
+    fclose(f);
+    return result;
+}
+
+void close_bench_client(struct bench_client *client) {
+    if (client->state == BENCH_CLOSED) {
+        return;
+    }
+    if (client->state == BENCH_OPEN) {
+        stats.disconnected++;
+    }
+    close(client->fd);
+    client->state = BENCH_CLOSED;
+    client->pending_len = 0;
+}
+
+// Mengirim sisa data klien. Mengembalikan -1 jika koneksi gagal.
+int flush_bench_client(struct bench_client *client) {
+    size_t offset = 0;
+    while (offset < client->pending_len) {
+        ssize_t n = send(client->fd, client->pending + offset, client->pending_len - offset, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            return -1;
+        }
+        offset += (size_t)n;
+    }
+    memmove(client->pending, client->pending + offset, client->pending_len - offset);
+    client->pending_len -= offset;
+    return 0;
+}
+
+// Menambahkan satu frame ke data tertunda klien lalu mencoba mengirimnya
+int send_bench_frame(struct bench_client *client, uint8_t type, const void *payload, size_t length) {
+    size_t need = client->pending_len + CHAT_FRAME_HEADER_SIZE + length;
+    if (need > client->pending_capacity) {
+        size_t capacity = client->pending_capacity ? client->pending_capacity : 256;
+        while (capacity < need) {
+            capacity *= 2;
+        }
+        char *pending = realloc(client->pending, capacity);
+        if (pending == NULL) {
+            return -1;
+        }
+        client->pending = pending;
+        client->pending_capacity = capacity;
+    }
+
+    chat_frame_header(client->pending + client->pending_len, type, (uint32_t)length);
+    memcpy(client->pending + client->pending_len + CHAT_FRAME_HEADER_SIZE, payload, length);
+    client->pending_len = need;
+    return flush_bench_client(client);
+}
+
+// Memulai koneksi non-blocking; selesai saat socket siap ditulis
+int start_connect(int epoll_fd, struct bench_client *client, const struct sockaddr_in *addr) {
+    client->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (client->fd < 0) {
+        perror("socket");
+        return -1;
+    }
+
+    client->connect_start = now_ns();
+    if (connect(client->fd, (const struct sockaddr *)addr, sizeof(*addr)) < 0 && errno != EINPROGRESS) {
+        close(client->fd);
+        return -1;
+    }
+
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.ptr = client;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client->fd, &event) < 0) {
+        perror("epoll_ctl");
+        close(client->fd);
+        return -1;
+    }
+    client->state = BENCH_CONNECTING;
+    return 0;
+}
+
+// Koneksi selesai: catat latensi koneksi lalu login (dan join room bila diminta)
+void finish_connect(struct bench_client *client) {
+    int error = 0;
+    socklen_t len = sizeof(error);
+    if (getsockopt(client->fd, SOL_SOCKET, SO_ERROR, &error, &len) < 0 || error != 0) {
+        stats.connect_failed++;
+        close(client->fd);
+        client->state = BENCH_CLOSED;
+        return;
+    }
+
+    chat_histogram_record(&stats.connect_latency, now_ns() - client->connect_start);
+    stats.connected++;
+    client->state = BENCH_OPEN;
+
+    char username[CHAT_USERNAME_MAX];
+    int name_len = snprintf(username, sizeof(username), "bench%d", client->id);
+    if (send_bench_frame(client, FRAME_LOGIN, username, (size_t)name_len) < 0 ||
+        (config.room != NULL && send_bench_frame(client, FRAME_JOIN, config.room, strlen(config.room)) < 0)) {
+        close_bench_client(client);
+    }
+}
+
+// Mencatat latensi end-to-end dari stempel waktu yang dibawa pesan
+void handle_bench_frame(const struct chat_frame *frame, uint64_t now) {
+    // Riwayat room yang dikirim saat login bukan bagian dari pengukuran
+    if (frame->type != FRAME_CHAT || (frame->flags & CHAT_FLAG_HISTORY)) {
+        return;
+    }
+
+    // Payload: u8 panjang pengirim | pengirim | u8 panjang room | room | teks
+    size_t offset = 0;
+    const char *field;
+    if (chat_read_field(frame->payload, frame->length, &offset, &field) < 0 ||
+        chat_read_field(frame->payload, frame->length, &offset, &field) < 0) {
+        return;
+    }
+    stats.received++;
+    stats.bytes_received += CHAT_FRAME_HEADER_SIZE + frame->length;
+    stats.last_receive = now;
+
+    if (frame->length - offset >= BENCH_STAMP_SIZE) {
+        uint64_t sent_at;
+        memcpy(&sent_at, frame->payload + offset, sizeof(sent_at));
+        if (sent_at <= now) {
+            chat_histogram_record(&stats.latency, now - sent_at);
+        }
+    }
+}
+
+void read_bench_client(struct bench_client *client) {
+    while (client->state == BENCH_OPEN) {
+        size_t space;
+        char *dst = chat_parser_write_ptr(&client->parser, &space);
+        if (dst == NULL) {
+            close_bench_client(client);
+            return;
+        }
+        ssize_t n = recv(client->fd, dst, space, 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                close_bench_client(client);
+            }
+            return;
+        }
+        if (n == 0) {
+            close_bench_client(client);
+            return;
+        }
+        chat_parser_commit(&client->parser, (size_t)n);
+
+        uint64_t now = now_ns();
+        struct chat_frame frame;
+        int rc;
+        while ((rc = chat_parser_next(&client->parser, &frame)) == 1) {
+            if (frame.type == FRAME_REJECT) {
+                // Ditolak admission control: bukan koneksi yang terputus
+                stats.rejected++;
+                stats.connected--;
+                close(client->fd);
+                client->state = BENCH_CLOSED;
+                return;
+            }
+            if (frame.type == FRAME_THROTTLE) {
+                stats.throttled++;
+                continue;
+            }
+            if (frame.type == FRAME_PING) {
+                // Heartbeat server harus dibalas agar klien diam tidak diputus
+                if (send_bench_frame(client, FRAME_PONG, frame.payload, frame.length) < 0) {
+                    close_bench_client(client);
+                    return;
+                }
+                continue;
+            }
+            handle_bench_frame(&frame, now);
+        }
+        if (rc < 0) {
+            fprintf(stderr, "[WARN] Frame tidak valid pada klien bench%d\n", client->id);
+            close_bench_client(client);
+            return;
+        }
+    }
+}
+
+// Mengirim satu pesan berstempel waktu dari klien pengirim
+void send_bench_message(struct bench_client *client, char *message, uint32_t sequence) {
+    if (client->state != BENCH_OPEN || client->pending_len > 0) {
+        stats.skipped++;
+        return;
+    }
+
+    uint64_t sent_at = now_ns();
+    uint32_t id = (uint32_t)client->id;
+    memcpy(message, &sent_at, sizeof(sent_at));
+    memcpy(message + 8, &id, sizeof(id));
+    memcpy(message + 12, &sequence, sizeof(sequence));
+    if (send_bench_frame(client, FRAME_CHAT, message, config.msg_size) < 0) {
+        close_bench_client(client);
+        return;
+    }
+    stats.sent++;
+}
+
+void print_text_report(void) {
+    double send_seconds = (double)(stats.send_end - stats.send_start) / 1e9;
+    uint64_t receive_end = stats.last_receive > stats.send_end ? stats.last_receive : stats.send_end;
+    double receive_seconds = (double)(receive_end - stats.send_start) / 1e9;
+
+    printf("chatBench: %d klien, %d pengirim, %.0f pesan/detik, %zu byte, %.1f detik\n",
+           config.clients, config.senders, config.msg_rate, config.msg_size, config.duration);
+    printf("Koneksi : %llu berhasil, %llu gagal, %llu ditolak, %llu terputus, %ld dibuang antrian listen (host)\n",
+           (unsigned long long)stats.connected, (unsigned long long)stats.connect_failed,
+           (unsigned long long)stats.rejected, (unsigned long long)stats.disconnected, stats.listen_drops);
+    printf("  latensi koneksi (ms)  : p50 %.3f  p99 %.3f  p999 %.3f  maks %.3f\n",
+           ns_to_ms(chat_histogram_percentile(&stats.connect_latency, 50.0)),
+           ns_to_ms(chat_histogram_percentile(&stats.connect_latency, 99.0)),
+           ns_to_ms(chat_histogram_percentile(&stats.connect_latency, 99.9)),
+           ns_to_ms(stats.connect_latency.max));
+    printf("Pesan   : %llu terkirim (%.1f/detik), %llu dilewati, %llu THROTTLE, %llu diterima (%.1f/detik, %.2f MB/detik)\n",
+           (unsigned long long)stats.sent, send_seconds > 0 ? stats.sent / send_seconds : 0.0,
+           (unsigned long long)stats.skipped, (unsigned long long)stats.throttled, (unsigned long long)stats.received,
+           receive_seconds > 0 ? stats.received / receive_seconds : 0.0,
+           receive_seconds > 0 ? stats.bytes_received / receive_seconds / 1e6 : 0.0);
+    printf("  latensi broadcast (ms): p50 %.3f  p99 %.3f  p999 %.3f  maks %.3f  rata-rata %.3f\n",
+           ns_to_ms(chat_histogram_percentile(&stats.latency, 50.0)),
+           ns_to_ms(chat_histogram_percentile(&stats.latency, 99.0)),
+           ns_to_ms(chat_histogram_percentile(&stats.latency, 99.9)),
+           ns_to_ms(stats.latency.max),
+           stats.latency.count ? ns_to_ms(stats.latency.sum / stats.latency.count) : 0.0);
+}
+
+void print_json_report(void) {
+    double send_seconds = (double)(stats.send_end - stats.send_start) / 1e9;
+    uint64_t receive_end = stats.last_receive > stats.send_end ? stats.last_receive : stats.send_end;
+    double receive_seconds = (double)(receive_end - stats.send_start) / 1e9;
+
+    printf("{\"clients\":%d,\"senders\":%d,\"msg_rate\":%.1f,\"msg_size\":%zu,\"duration_s\":%.3f,",
+           config.clients, config.senders, config.msg_rate, config.msg_size, config.duration);
+    printf("\"connect\":{\"ok\":%llu,\"failed\":%llu,\"rejected\":%llu,\"disconnected\":%llu,\"listen_drops\":%ld,"
+           "\"p50_ms\":%.3f,\"p99_ms\":%.3f,\"p999_ms\":%.3f,\"max_ms\":%.3f},",
+           (unsigned long long)stats.connected, (unsigned long long)stats.connect_failed,
+           (unsigned long long)stats.rejected, (unsigned long long)stats.disconnected, stats.listen_drops,
+           ns_to_ms(chat_histogram_percentile(&stats.connect_latency, 50.0)),
+           ns_to_ms(chat_histogram_percentile(&stats.connect_latency, 99.0)),
+           ns_to_ms(chat_histogram_percentile(&stats.connect_latency, 99.9)),
+           ns_to_ms(stats.connect_latency.max));
+    printf("\"messages\":{\"sent\":%llu,\"skipped\":%llu,\"throttled\":%llu,\"received\":%llu,"
+           "\"sent_per_sec\":%.1f,\"received_per_sec\":%.1f,\"received_bytes_per_sec\":%.0f},",
+           (unsigned long long)stats.sent, (unsigned long long)stats.skipped,
+           (unsigned long long)stats.throttled, (unsigned long long)stats.received,
+           send_seconds > 0 ? stats.sent / send_seconds : 0.0,
+           receive_seconds > 0 ? stats.received / receive_seconds : 0.0,
+           receive_seconds > 0 ? stats.bytes_received / receive_seconds : 0.0);
+    printf("\"latency_ms\":{\"samples\":%llu,\"p50\":%.3f,\"p99\":%.3f,\"p999\":%.3f,\"max\":%.3f,\"mean\":%.3f}}\n",
+           (unsigned long long)stats.latency.count,
+           ns_to_ms(chat_histogram_percentile(&stats.latency, 50.0)),
+           ns_to_ms(chat_histogram_percentile(&stats.latency, 99.0)),
+           ns_to_ms(chat_histogram_percentile(&stats.latency, 99.9)),
+           ns_to_ms(stats.latency.max),
+           stats.latency.count ? ns_to_ms(stats.latency.sum / stats.latency.count) : 0.0);
+}
+
+void print_usage(const char *prog) {
+    printf("Penggunaan: %s [opsi]\n", prog);
+    printf("  --host ADDR           alamat server (default: 127.0.0.1)\n");
+    printf("  --port N              port server (default: %d)\n", PORT);
+    printf("  --clients N           jumlah klien simulasi (default: 100)\n");
+    printf("  --connect-rate N      koneksi baru per detik saat ramp-up (default: 1000)\n");
+    printf("  --senders N           jumlah klien yang mengirim pesan (default: 1)\n");
+    printf("  --rate N              total pesan per detik dari semua pengirim (default: 100)\n");
+    printf("  --size N              ukuran teks pesan dalam byte, minimal %d (default: 64)\n", BENCH_STAMP_SIZE);
+    printf("  --duration S          lama fase pengiriman dalam detik (default: 10)\n");
+    printf("  --room NAME           gabung ke room ini sebelum mengirim (default: room server)\n");
+    printf("  --json                tampilkan hasil sebagai JSON\n");
+}
+
+int main(int argc, char *argv[]) {
+    static const struct option long_options[] = {
+        {"host", required_argument, NULL, 'H'},
+        {"port", required_argument, NULL, 'P'},
+        {"clients", required_argument, NULL, 'c'},
+        {"connect-rate", required_argument, NULL, 'C'},
+        {"senders", required_argument, NULL, 's'},
+        {"rate", required_argument, NULL, 'r'},
+        {"size", required_argument, NULL, 'z'},
+        {"duration", required_argument, NULL, 'd'},
+        {"room", required_argument, NULL, 'R'},
+        {"json", no_argument, NULL, 'j'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+
+    config.host = "127.0.0.1";
+    config.port = PORT;
+    config.clients = 100;
+    config.connect_rate = 1000;
+    config.senders = 1;
+    config.msg_rate = 100;
+    config.msg_size = 64;
+    config.duration = 10;
+    config.room = NULL;
+    config.json = 0;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "H:P:c:C:s:r:z:d:R:jh", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'H':
+            config.host = optarg;
+            break;
+        case 'P':
+            config.port = atoi(optarg);
+            break;
+        case 'c':
+            config.clients = atoi(optarg);
+            break;
+        case 'C':
+            config.connect_rate = atoi(optarg);
+            break;
+        case 's':
+            config.senders = atoi(optarg);
+            break;
+        case 'r':
+            config.msg_rate = atof(optarg);
+            break;
+        case 'z':
+            config.msg_size = strtoul(optarg, NULL, 10);
+            break;
+        case 'd':
+            config.duration = atof(optarg);
+            break;
+        case 'R':
+            config.room = optarg;
+            break;
+        case 'j':
+            config.json = 1;
+            break;
+        default:
+            print_usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    if (config.clients < 1 || config.connect_rate < 1 || config.msg_rate <= 0 || config.duration <= 0) {
+        fprintf(stderr, "Jumlah klien, laju koneksi, laju pesan, dan durasi harus positif\n");
+        return EXIT_FAILURE;
+    }
+    if (config.senders < 1 || config.senders > config.clients) {
+        config.senders = config.clients;
+    }
+    if (config.msg_size < BENCH_STAMP_SIZE || config.msg_size > CHAT_DEFAULT_MAX_PAYLOAD) {
+        fprintf(stderr, "Ukuran pesan harus antara %d dan %d byte\n", BENCH_STAMP_SIZE, CHAT_DEFAULT_MAX_PAYLOAD);
+        return EXIT_FAILURE;
+    }
+    if (config.room != NULL && (strlen(config.room) == 0 || strlen(config.room) > CHAT_ROOM_MAX)) {
+        fprintf(stderr, "Nama room tidak valid\n");
+        return EXIT_FAILURE;
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(config.port);
+    if (inet_pton(AF_INET, config.host, &addr.sin_addr) <= 0) {
+        fprintf(stderr, "Alamat tidak valid: %s\n", config.host);
+        return EXIT_FAILURE;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    raise_fd_limit();
+
+    struct bench_client *clients = calloc((size_t)config.clients, sizeof(*clients));
+    char *message = malloc(config.msg_size);
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (clients == NULL || message == NULL || epoll_fd < 0) {
+        perror("Gagal menyiapkan benchmark");
+        return EXIT_FAILURE;
+    }
+    memset(message, 'x', config.msg_size);
+    chat_histogram_reset(&stats.connect_latency);
+    chat_histogram_reset(&stats.latency);
+
+    for (int i = 0; i < config.clients; i++) {
+        clients[i].id = i;
+        clients[i].state = BENCH_CLOSED;
+        if (chat_parser_init(&clients[i].parser, CHAT_DEFAULT_MAX_PAYLOAD) < 0) {
+            perror("chat_parser_init");
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Fase 1: ramp-up koneksi dengan laju tetap sampai semua klien selesai terhubung
+    // Fase 2: setiap pengirim bergiliran mengirim pesan sesuai jadwal --rate
+    // Fase 3: menunggu pesan yang masih di jalan
+    int opened = 0;
+    int sender_cursor = 0;
+    uint32_t sequence = 0;
+    uint64_t ramp_start = now_ns();
+    long listen_drops_start = read_listen_drops();
+    uint64_t settle_until = 0;
+    uint64_t drain_until = 0;
+    struct epoll_event events[MAX_EVENTS];
+
+    while (1) {
+        uint64_t now = now_ns();
+
+        if (opened < config.clients) {
+            // Jumlah koneksi yang seharusnya sudah dibuka pada titik waktu ini
+            uint64_t due = (now - ramp_start) * (uint64_t)config.connect_rate / 1000000000ull + 1;
+            while (opened < config.clients && (uint64_t)opened < due) {
+                if (start_connect(epoll_fd, &clients[opened], &addr) < 0) {
+                    stats.connect_failed++;
+                }
+                opened++;
+            }
+        } else if (stats.send_start == 0) {
+            if (stats.connected + stats.connect_failed + stats.rejected >= (uint64_t)config.clients) {
+                if (settle_until == 0) {
+                    settle_until = now + BENCH_SETTLE_MS * 1000000ull;
+                } else if (now >= settle_until) {
+                    long listen_drops = read_listen_drops();
+                    stats.listen_drops = listen_drops >= 0 && listen_drops_start >= 0 ? listen_drops - listen_drops_start : -1;
+                    if (stats.connected == 0) {
+                        fprintf(stderr, "Tidak ada klien yang berhasil terhubung\n");
+                        return EXIT_FAILURE;
+                    }
+                    stats.send_start = now;
+                    stats.received = 0;
+                    stats.bytes_received = 0;
+                }
+            }
+        } else if (stats.send_end == 0) {
+            // Kirim semua pesan yang jatuh tempo sejak fase pengiriman dimulai
+            double elapsed = (double)(now - stats.send_start) / 1e9;
+            if (elapsed >= config.duration) {
+                stats.send_end = now;
+                drain_until = now + BENCH_DRAIN_MS * 1000000ull;
+            } else {
+                uint64_t due = (uint64_t)(elapsed * config.msg_rate) + 1;
+                while (stats.sent + stats.skipped < due) {
+                    send_bench_message(&clients[sender_cursor], message, sequence++);
+                    sender_cursor = (sender_cursor + 1) % config.senders;
+                }
+            }
+        } else {
+            // Selesai jika semua salinan sudah diterima atau batas waktu habis
+            uint64_t open = stats.connected - stats.disconnected;
+            uint64_t expected = open > 0 ? stats.sent * (open - 1) : 0;
+            if (stats.received >= expected || now >= drain_until) {
+                break;
+            }
+        }
+
+        int ready = epoll_wait(epoll_fd, events, MAX_EVENTS, 1);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait");
+            break;
+        }
+        for (int i = 0; i < ready; i++) {
+            struct bench_client *client = events[i].data.ptr;
+            if (client->state == BENCH_CONNECTING) {
+                if (events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) {
+                    finish_connect(client);
+                }
+                continue;
+            }
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP)) {
+                read_bench_client(client);
+            }
+            if ((events[i].events & EPOLLOUT) && client->state == BENCH_OPEN &&
+                flush_bench_client(client) < 0) {
+                close_bench_client(client);
+            }
+        }
+    }
+
+    if (config.json) {
+        print_json_report();
+    } else {
+        print_text_report();
+    }
+
+    for (int i = 0; i < config.clients; i++) {
+        if (clients[i].state != BENCH_CLOSED) {
+            close(clients[i].fd);
+        }
+        chat_parser_free(&clients[i].parser);
+        free(clients[i].pending);
+    }
+    free(clients);
+    free(message);
+    close(epoll_fd);
+    return EXIT_SUCCESS;
+}
@@ -1,4 +1,7 @@
+#define _GNU_SOURCE
 #include <stdio.h>
+#include <ctype.h>
+#include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -6,197 +9,2617 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <time.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <getopt.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
 #include <sys/select.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/uio.h>
+
+#include "chatHandoff.h"
+#include "chatJournal.h"
+#include "chatLog.h"
+#include "chatMetrics.h"
+#include "chatProtocol.h"
+#include "chatQueue.h"
+#include "chatRing.h"
+#include "chatRoom.h"
+#include "chatSession.h"
+#include "chatTimer.h"
+#include "chatUring.h"
 
 #define BUFFER_SIZE 1024
 #define LOG_FILE "chat_log.txt"
+#define METRICS_SOCKET "chat_metrics.sock"
+#define JOURNAL_DIR "chat_journal"
+#define HANDOFF_SOCKET "chat_handoff.sock"
+#define HANDOFF_TIMEOUT_MS 5000  // batas tunggu server baru selama serah terima
+#define PORT 8080
+#define MAX_EVENTS 256
+#define SHARD_RING_SIZE 4096
+#define URING_ENTRIES 4096
+#define URING_BUFFERS 1024       // buffer recv per shard (pangkat dua)
+#define URING_BUFFER_SIZE 4096
+#define URING_SEND_IOV 64        // frame maksimum per sendmsg
+
+// Saran waktu tunggu di frame REJECT sebelum klien mencoba lagi
+#define REJECT_RETRY_FULL_MS 5000  // server penuh (--max-sessions)
+#define REJECT_RETRY_RATE_MS 1000  // laju koneksi baru melewati --accept-rate
+
+// Batas laju frame per sesi: token bucket menampung burst sebanyak
+// RATE_BURST_S detik laju, dan THROTTLE (beserta log-nya) dikirim paling
+// banyak sekali per THROTTLE_NOTICE_S detik per klien
+#define RATE_BURST_S 2
+#define THROTTLE_NOTICE_S 1
+
+// Resolusi timing wheel untuk heartbeat dan timeout sesi
+#define TIMER_TICK_MS 100
+#define TIMER_TICK_NS ((uint64_t)TIMER_TICK_MS * 1000000)
+#define SECONDS_TO_TICKS(s) ((uint32_t)(s) * (1000 / TIMER_TICK_MS))
+
+// user_data request io_uring: jenis di 8 bit bawah, lalu generasi sesi (24
+// bit) dan fd, atau indeks slot kirim untuk URING_OP_SEND
+enum uring_op {
+    URING_OP_ACCEPT,
+    URING_OP_WAKE,
+    URING_OP_RECV,
+    URING_OP_SEND,
+    URING_OP_CANCEL  // pembatalan semua request saat serah terima
+};
+#define URING_DATA(op, generation, value) ((uint64_t)(op) | ((uint64_t)((generation) & 0xffffff) << 8) | ((uint64_t)(uint32_t)(value) << 32))
+#define URING_DATA_OP(data) ((unsigned int)((data) & 0xff))
+#define URING_DATA_GENERATION(data) ((uint32_t)(((data) >> 8) & 0xffffff))
+#define URING_DATA_VALUE(data) ((int)((data) >> 32))
+
+// Backend I/O event loop shard
+enum io_backend {
+    BACKEND_EPOLL, // epoll edge-triggered, recv()/writev() per klien
+    BACKEND_URING  // io_uring: multishot accept/recv, sendmsg dikumpulkan per iterasi
+};
+
+// Jenis pesan antar shard
+enum shard_message_kind {
+    SHARD_MSG_ROOM,  // target = nama room
+    SHARD_MSG_DIRECT // target = username penerima
+};
+
+// Elemen inbox shard: frame yang sudah di-encode beserta tujuannya
+struct shard_message {
+    struct chat_buffer *buf;
+    uint64_t received_at;  // waktu recv() di shard asal, untuk metrik latensi
+    unsigned char kind;
+    unsigned char target_len;
+    char target[CHAT_USERNAME_MAX > CHAT_ROOM_MAX ? CHAT_USERNAME_MAX : CHAT_ROOM_MAX];
+};
+
+// Kebijakan untuk klien yang antrian kirimnya melewati batas
+enum slow_consumer_policy {
+    SLOW_DROP_OLDEST, // Buang frame tertua yang belum terkirim
+    SLOW_COALESCE,    // Ganti semua frame yang belum terkirim dengan satu pemberitahuan
+    SLOW_DISCONNECT   // Putus koneksi klien
+};
+
+// Satu sendmsg yang sedang berjalan di io_uring. msghdr dan iov harus tetap
+// ada sampai completion, dan buffer frame ditahan sampai kernel selesai
+// membacanya (untuk zero-copy: sampai notifikasi), walaupun sesinya sudah
+// ditutup lebih dulu.
+struct uring_send {
+    int index;      // posisi di shard->sends, dipakai sebagai user_data
+    int next_free;
+    int fd;
+    uint32_t generation;
+    unsigned int count;
+    struct msghdr msg;
+    struct iovec iov[URING_SEND_IOV];
+    struct chat_buffer *bufs[URING_SEND_IOV];
+};
+
+// Satu shard = satu thread worker dengan listener SO_REUSEPORT, epoll, dan
+// daftar klien sendiri. Antar shard hanya berkomunikasi lewat inbox.
+struct shard {
+    int id;
+    pthread_t thread;
+    int epoll_fd;
+    int server_fd;
+    int accept_pending;  // listener masih punya koneksi antre setelah satu batch accept
+    int wake_fd;
+    atomic_int wake_pending;
+    struct chat_ring inbox;
+
+    // Sesi dan room milik shard ini
+    struct session_table sessions;
+    struct room_table rooms;
+
+    // fd klien yang antriannya perlu di-flush di akhir iterasi event loop
+    int *flush_fds;
+    size_t flush_count;
+    size_t flush_capacity;
+
+    // Slot metrik shard ini dan waktu recv() pesan yang dikirim selama iterasi
+    // ini; latensinya dicatat setelah antrian di-flush
+    struct shard_metrics *metrics;
+    uint64_t *deliveries;
+    size_t delivery_count;
+    size_t delivery_capacity;
+
+    // Timer heartbeat dan timeout semua sesi shard ini, diindeks fd. tick
+    // diperbarui sekali per iterasi event loop.
+    struct timer_wheel timers;
+    uint64_t tick;
+    struct chat_buffer *ping;  // frame PING tick ini, dipakai bersama semua sesi
+    uint64_t ping_built_at;
+
+    // Token bucket laju koneksi baru shard ini (admission control)
+    double accept_tokens;
+    uint64_t accept_refill_at;
+
+    // Backend io_uring (NULL = epoll)
+    struct chat_uring *ring;
+    uint64_t wake_value;       // tujuan read() eventfd lewat ring
+    uint32_t next_generation;
+    struct uring_send **sends;
+    int send_count;
+    int send_free;             // kepala daftar slot kirim kosong, -1 jika tidak ada
+    unsigned int send_pending; // sendmsg yang hasilnya belum diterima
+    int handoff;               // serah terima berjalan: tidak ada sendmsg baru
+
+    // Snapshot sesi untuk serah terima ke server baru, beserta fd kliennya
+    struct handoff_buffer snapshot;
+    int *snapshot_fds;
+    size_t snapshot_count;
+};
+
+// Konfigurasi server dari argumen command line
+struct server_config {
+    int num_shards;
+    int pin_cpus;
+    size_t max_message;
+    unsigned int out_queue_len;
+    size_t out_queue_bytes;
+    enum slow_consumer_policy slow_policy;
+    struct log_config log;
+    struct metrics_config metrics;
+    struct journal_config journal;
+    unsigned int history;  // jumlah pesan riwayat yang dikirim saat masuk room
+    enum io_backend backend;
+    size_t zerocopy_min;   // sendmsg zero-copy mulai ukuran ini (0 = mati)
+    int backlog;           // panjang antrian listen()
+    int defer_accept;      // detik TCP_DEFER_ACCEPT (0 = mati)
+    unsigned int accept_batch; // koneksi maksimum per event listener sebelum klien lain dilayani
+    long max_sessions;     // batas sesi di semua shard (0 = tanpa batas)
+    double accept_rate;    // koneksi baru per detik di semua shard (0 = tanpa batas)
+    // Batas laju frame dari setiap klien (0 = tanpa batas)
+    double msg_rate;             // frame per detik
+    double byte_rate;            // byte per detik
+    unsigned int dup_window;     // detik payload yang sama dibuang (0 = mati)
+    // Heartbeat dan timeout sesi dalam detik (0 = mati)
+    unsigned int ping_interval;  // PING setelah klien diam selama ini
+    unsigned int idle_timeout;   // putus jika tidak ada data (termasuk PONG) selama ini
+    unsigned int login_timeout;  // putus jika LOGIN belum diterima
+    unsigned int write_stall;    // putus jika antrian kirim tidak berkurang selama ini
+    const char *handoff_path;    // socket Unix serah terima (NULL = mati)
+    int takeover;                // ambil alih sesi dari server yang sedang berjalan
+};
+
+struct server_config config;
+struct shard **shards;
+
+// Jumlah sesi di semua shard, untuk --max-sessions
+atomic_long active_sessions;
+
+// Serah terima ke server baru. Thread utama menyalakan handoff_requested dan
+// membangunkan semua shard; setiap shard berhenti di akhir iterasi event loop,
+// menambah handoff_stopped, lalu membuat snapshot setelah semua shard
+// berhenti. handoff_barrier (semua shard + thread utama) dipakai dua kali:
+// snapshot siap, lalu hasil serah terima (handoff_result) sudah diisi.
+atomic_int handoff_requested;
+atomic_int handoff_stopped;
+atomic_int handoff_result;
+pthread_barrier_t handoff_barrier;
+
+// Fungsi untuk mengubah socket menjadi non-blocking
+int set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0) {
+        return -1;
+    }
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+// Kebalikan set_nonblocking(). Backend io_uring butuh fd blocking: pada fd
+// O_NONBLOCK request langsung selesai dengan -EAGAIN, bukan menunggu lewat
+// poll internal io_uring.
+int set_blocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0) {
+        return -1;
+    }
+    return fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+}
+
+// Mengambil slot kirim io_uring yang kosong (slot tidak pernah dipindah agar
+// msghdr-nya tetap valid selama request berjalan)
+struct uring_send *uring_send_get(struct shard *shard) {
+    if (shard->send_free >= 0) {
+        struct uring_send *op = shard->sends[shard->send_free];
+        shard->send_free = op->next_free;
+        return op;
+    }
+    struct uring_send *op = malloc(sizeof(*op));
+    if (op == NULL) {
+        return NULL;
+    }
+    struct uring_send **grown = realloc(shard->sends, (shard->send_count + 1) * sizeof(*grown));
+    if (grown == NULL) {
+        free(op);
+        return NULL;
+    }
+    shard->sends = grown;
+    op->index = shard->send_count;
+    shard->sends[shard->send_count++] = op;
+    return op;
+}
 
-// Variabel untuk mencatat klien
-int client_sockets[FD_SETSIZE] = {0};
-char client_usernames[FD_SETSIZE][BUFFER_SIZE];
+// Melepas buffer yang ditahan slot kirim dan mengembalikan slotnya
+void uring_send_put(struct shard *shard, struct uring_send *op) {
+    for (unsigned int i = 0; i < op->count; i++) {
+        chat_buffer_release(op->bufs[i]);
+    }
+    op->count = 0;
+    op->next_free = shard->send_free;
+    shard->send_free = op->index;
+}
 
-// Fungsi untuk mencatat pesan ke log
-void log_message(const char *level, const char *username, const char *message) {
-    FILE *log_file = fopen(LOG_FILE, "a"); // Membuka file log dalam mode append
-    if (log_file == NULL) {
-        perror("[ERROR] Gagal membuka file log");
+// Menyiapkan satu sendmsg berisi frame terdepan antrian klien. Hanya satu
+// kiriman per socket yang berjalan sekaligus agar urutan byte terjaga; sisa
+// antrian dikirim setelah completion-nya diterima. Tidak ada syscall di sini:
+// semua SQE dikirim bersama di io_uring_enter() berikutnya.
+void uring_send_start(struct shard *shard, struct session *session) {
+    struct out_queue *queue = &session->queue;
+    if (queue->inflight > 0 || queue->count == 0 || shard->handoff) {
+        return;
+    }
+    struct uring_send *op = uring_send_get(shard);
+    if (op == NULL) {
+        perror("malloc");
         return;
     }
 
-    // Mendapatkan waktu saat ini
-    time_t now = time(NULL);
-    struct tm *t = localtime(&now);
+    op->fd = session->fd;
+    op->generation = session->generation;
+    // Paling banyak separuh antrian ditahan, sisanya tetap bisa dibuang
+    // kebijakan slow consumer
+    unsigned int max = queue->capacity / 2 < URING_SEND_IOV ? queue->capacity / 2 : URING_SEND_IOV;
+    op->count = out_queue_fill_iov(queue, op->iov, op->bufs, max);
+    size_t total = 0;
+    for (unsigned int i = 0; i < op->count; i++) {
+        chat_buffer_retain(op->bufs[i]);
+        total += op->iov[i].iov_len;
+    }
+    memset(&op->msg, 0, sizeof(op->msg));
+    op->msg.msg_iov = op->iov;
+    op->msg.msg_iovlen = op->count;
 
-    // Format waktu
-    char time_str[20];
-    if (strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", t) == 0) {
-        fprintf(stderr, "[ERROR] Gagal memformat waktu untuk log\n");
-        fclose(log_file);
+    // Zero-copy hanya sepadan untuk kiriman besar: pinning halaman dan CQE
+    // notifikasi tambahan lebih mahal daripada menyalin pesan chat biasa
+    int zerocopy = config.zerocopy_min > 0 && total >= config.zerocopy_min;
+    if (chat_uring_sendmsg(shard->ring, op->fd, &op->msg, zerocopy, URING_DATA(URING_OP_SEND, 0, op->index)) < 0) {
+        perror("io_uring sendmsg");
+        uring_send_put(shard, op);
         return;
     }
+    shard->send_pending++;
+    queue->inflight = op->count;
+}
 
-    // Menulis pesan ke log dengan timestamp, level, username, dan pesan
-    if (username != NULL && strlen(username) > 0) {
-        fprintf(log_file, "[%s] [%s] %s: %s\n", time_str, level, username, message);
-    } else {
-        fprintf(log_file, "[%s] [%s] %s\n", time_str, level, message);
+// Fungsi untuk menutup koneksi klien dan menghapusnya dari daftar
+void close_client(struct shard *shard, int client_fd) {
+    // close() otomatis melepas fd dari epoll. Request io_uring menahan
+    // referensi socket sendiri, jadi socket di-shutdown dulu agar recv
+    // multishot dan sendmsg yang masih berjalan selesai.
+    if (shard->ring != NULL) {
+        shutdown(client_fd, SHUT_RDWR);
+    }
+    close(client_fd);
+    timer_cancel(&shard->timers, client_fd);
+    struct session *session = session_get(&shard->sessions, client_fd);
+    if (session != NULL) {
+        char disconnect_message[BUFFER_SIZE];
+        snprintf(disconnect_message, sizeof(disconnect_message), "Klien %s keluar dari chat.",
+                 session->user != NULL ? session->user->name : "");
+        log_message("INFO", NULL, disconnect_message);
+        printf("[INFO] %s\n", disconnect_message);
+        room_leave_all(&shard->rooms, session);
+        session_remove(&shard->sessions, client_fd);
+        atomic_fetch_sub_explicit(&active_sessions, 1, memory_order_relaxed);
+        metric_set(&shard->metrics->sessions, shard->sessions.count);
+    }
+}
+
+// Mengirim isi antrian klien langsung sampai habis atau sampai socket penuh.
+// Sisa antrian dikirim lagi saat EPOLLOUT berikutnya. Mengembalikan -1 jika
+// klien diputus (sesi sudah dihapus).
+int write_client(struct shard *shard, struct session *session) {
+    int fd = session->fd;
+    size_t queued = session->queue.bytes;
+    unsigned long writes = 0;
+    int rc = out_queue_flush(&session->queue, fd, &writes);
+    metric_add(&shard->metrics->syscalls, writes);
+    if (rc < 0) {
+        if (errno != EPIPE && errno != ECONNRESET) {
+            perror("Gagal mengirim pesan");
+        }
+        close_client(shard, fd);
+        return -1;
+    }
+    if (session->queue.bytes < queued) {
+        session->stall_tick = (uint32_t)shard->tick;
+        metric_add(&shard->metrics->bytes_out, queued - session->queue.bytes);
+    }
+    return 0;
+}
+
+// Mengirim antrian klien sesuai backend. Pada io_uring hanya menyiapkan
+// sendmsg; hasilnya diproses di uring_handle_send().
+int flush_client(struct shard *shard, struct session *session) {
+    if (shard->ring != NULL) {
+        uring_send_start(shard, session);
+        return 0;
+    }
+    return write_client(shard, session);
+}
+
+// Mengirim semua antrian yang mendapat frame baru selama iterasi ini, sehingga
+// beberapa frame untuk klien yang sama digabung dalam satu writev().
+void flush_pending_clients(struct shard *shard) {
+    for (size_t i = 0; i < shard->flush_count; i++) {
+        struct session *session = session_get(&shard->sessions, shard->flush_fds[i]);
+        if (session != NULL && session->flush_pending) {
+            session->flush_pending = 0;
+            flush_client(shard, session);
+        }
     }
+    shard->flush_count = 0;
+}
 
-    fclose(log_file);
+// Menandai sesi agar antriannya dikirim di akhir iterasi event loop
+void mark_flush(struct shard *shard, struct session *session) {
+    if (session->flush_pending) {
+        return;
+    }
+    if (shard->flush_count == shard->flush_capacity) {
+        size_t capacity = shard->flush_capacity > 0 ? shard->flush_capacity * 2 : 256;
+        int *grown = realloc(shard->flush_fds, capacity * sizeof(*grown));
+        if (grown == NULL) {
+            // Tanpa tempat di daftar, kirim sekarang juga
+            flush_client(shard, session);
+            return;
+        }
+        shard->flush_fds = grown;
+        shard->flush_capacity = capacity;
+    }
+    session->flush_pending = 1;
+    shard->flush_fds[shard->flush_count++] = session->fd;
 }
 
-// Fungsi untuk broadcast pesan ke semua klien
-void broadcast_message(int sender_fd, const char *message) {
-    char broadcast_message[BUFFER_SIZE + BUFFER_SIZE];
-    char sender_username[BUFFER_SIZE] = "Unknown";
+// Memasukkan frame ke antrian kirim klien dengan menerapkan kebijakan slow
+// consumer. Mengembalikan -1 jika klien diputus (sesi sudah dihapus).
+int queue_frame(struct shard *shard, struct session *session, struct chat_buffer *buf) {
+    struct out_queue *queue = &session->queue;
+
+    // Sebelum menerapkan kebijakan, coba kirim dulu isi antrian: batas hanya
+    // berlaku untuk byte yang benar-benar tertahan karena klien lambat. Pada
+    // io_uring antrian ditulis langsung juga (tanpa menunggu), kecuali ada
+    // sendmsg yang masih berjalan karena urutan byte harus terjaga.
+    if ((queue->count == queue->capacity || queue->bytes + buf->length > config.out_queue_bytes) &&
+        queue->inflight == 0) {
+        if (write_client(shard, session) < 0) {
+            return -1;
+        }
+    }
 
-    // Cari username pengirim
-    for (int i = 0; i < FD_SETSIZE; i++) {
-        if (client_sockets[i] == sender_fd) {
-            strncpy(sender_username, client_usernames[i], BUFFER_SIZE);
+    if (queue->count == queue->capacity || queue->bytes + buf->length > config.out_queue_bytes) {
+        switch (config.slow_policy) {
+        case SLOW_DISCONNECT:
+            fprintf(stderr, "[WARN] Klien fd %d terlalu lambat (%zu byte antre), koneksi diputus\n", session->fd, queue->bytes);
+            log_message("WARN", session->user != NULL ? session->user->name : NULL, "Klien terlalu lambat, koneksi diputus.");
+            close_client(shard, session->fd);
+            return -1;
+        case SLOW_DROP_OLDEST:
+            while ((queue->count == queue->capacity || queue->bytes + buf->length > config.out_queue_bytes) &&
+                   out_queue_drop_oldest(queue)) {
+                metric_add(&shard->metrics->frames_dropped, 1);
+            }
+            break;
+        case SLOW_COALESCE: {
+            unsigned int dropped = out_queue_drop_unsent(queue);
+            metric_add(&shard->metrics->frames_dropped, dropped);
+            char notice[64];
+            int len = snprintf(notice, sizeof(notice), "[%u pesan terlewat]", dropped);
+            struct chat_buffer *gap = chat_buffer_frame(FRAME_CONTROL, notice, len);
+            if (gap != NULL && queue->count + 1 < queue->capacity) {
+                out_queue_push(queue, gap);
+            }
+            if (gap != NULL) {
+                chat_buffer_release(gap);
+            }
             break;
         }
+        }
     }
 
-    snprintf(broadcast_message, sizeof(broadcast_message), "[CHAT] [%s]: %s", sender_username, message);
+    // Semua frame yang tersisa sedang dikirim: frame baru yang dibuang
+    if (queue->count == queue->capacity) {
+        metric_add(&shard->metrics->frames_dropped, 1);
+        return 0;
+    }
 
-    for (int i = 0; i < FD_SETSIZE; i++) {
-        if (client_sockets[i] != 0 && client_sockets[i] != sender_fd) {
-            if (send(client_sockets[i], broadcast_message, strlen(broadcast_message), 0) == -1) {
-                perror("Gagal mengirim pesan");
+    // Antrian mulai terisi: hitung macet sejak sekarang dan pastikan timer sesi
+    // berbunyi paling lambat saat batas --write-stall tercapai
+    if (queue->count == 0) {
+        session->stall_tick = (uint32_t)shard->tick;
+        if (config.write_stall > 0) {
+            uint64_t deadline = shard->tick + SECONDS_TO_TICKS(config.write_stall);
+            uint64_t expires = timer_expires(&shard->timers, session->fd);
+            if (expires == 0 || deadline < expires) {
+                timer_schedule(&shard->timers, session->fd, deadline);
             }
         }
     }
+    out_queue_push(queue, buf);
+    mark_flush(shard, session);
+    metric_add(&shard->metrics->frames_out, 1);
+    chat_histogram_record(&shard->metrics->queue_depth, queue->count);
+    return 0;
 }
 
-void handle_client_message(int client_fd) {
-    char buffer[BUFFER_SIZE];
-    int bytes_received = recv(client_fd, buffer, sizeof(buffer), 0);
-    if (bytes_received <= 0) {
-        // Handle disconnect
-        close(client_fd);
-        for (int i = 0; i < FD_SETSIZE; i++) {
-            if (client_sockets[i] == client_fd) {
-                char disconnect_message[BUFFER_SIZE];
-                snprintf(disconnect_message, sizeof(disconnect_message), "Klien %s keluar dari chat.", client_usernames[i]);
-                log_message("INFO", NULL, disconnect_message);
-                printf("[INFO] %s\n", disconnect_message);
-                client_sockets[i] = 0;
-                memset(client_usernames[i], 0, BUFFER_SIZE);
-                break;
+// Memasukkan frame yang sudah di-encode ke antrian semua anggota lokal room,
+// kecuali pengirim. Hanya anggota room yang disentuh, tanpa salinan maupun
+// syscall per penerima. Mengembalikan jumlah penerima.
+size_t room_broadcast_local(struct shard *shard, struct room *room, int sender_fd, struct chat_buffer *buf) {
+    size_t recipients = 0;
+    room->busy = 1;
+    size_t i = 0;
+    while (i < room->count) {
+        int fd = room->members[i];
+        struct session *session = session_get(&shard->sessions, fd);
+        if (fd != sender_fd && session != NULL) {
+            if (queue_frame(shard, session, buf) < 0) {
+                // Anggota terakhir sudah dipindah ke posisi i, periksa posisi yang sama lagi
+                continue;
             }
+            recipients++;
+        }
+        i++;
+    }
+    room->busy = 0;
+    room_release(&shard->rooms, room);
+
+    metric_add(&shard->metrics->broadcasts, 1);
+    chat_histogram_record(&shard->metrics->fanout, recipients);
+    return recipients;
+}
+
+// Mencatat waktu recv() pesan yang baru masuk antrian penerima. Latensinya
+// dihitung di record_deliveries() setelah antrian di-flush.
+void note_delivery(struct shard *shard, uint64_t received_at) {
+    if (shard->delivery_count == shard->delivery_capacity) {
+        size_t capacity = shard->delivery_capacity > 0 ? shard->delivery_capacity * 2 : 256;
+        uint64_t *grown = realloc(shard->deliveries, capacity * sizeof(*grown));
+        if (grown == NULL) {
+            return; // Sampel metrik boleh hilang
+        }
+        shard->deliveries = grown;
+        shard->delivery_capacity = capacity;
+    }
+    shard->deliveries[shard->delivery_count++] = received_at;
+}
+
+void record_deliveries(struct shard *shard) {
+    if (shard->delivery_count == 0) {
+        return;
+    }
+    uint64_t now = metrics_now();
+    for (size_t i = 0; i < shard->delivery_count; i++) {
+        chat_histogram_record(&shard->metrics->delivery_ns, now - shard->deliveries[i]);
+    }
+    shard->delivery_count = 0;
+}
+
+// Mengirim pemberitahuan (frame CONTROL) ke satu klien
+void send_notice(struct shard *shard, struct session *session, const char *format, ...) {
+    char text[BUFFER_SIZE];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (len < 0) {
+        return;
+    }
+    if ((size_t)len >= sizeof(text)) {
+        len = sizeof(text) - 1;
+    }
+
+    struct chat_buffer *buf = chat_buffer_frame(FRAME_CONTROL, text, len);
+    if (buf == NULL) {
+        perror("malloc");
+        return;
+    }
+    queue_frame(shard, session, buf);
+    chat_buffer_release(buf);
+}
+
+// Tick timing wheel saat ini dari jam monoton
+uint64_t current_tick(void) {
+    return metrics_now() / TIMER_TICK_NS;
+}
+
+// Waktu sejak since (dalam tick) sudah mencapai batas seconds. Batas 0 berarti
+// timeout tersebut mati.
+int tick_expired(uint32_t now, uint32_t since, unsigned int seconds) {
+    return seconds > 0 && now - since >= SECONDS_TO_TICKS(seconds);
+}
+
+// Memperkecil remaining menjadi sisa tick sampai batas seconds sejak since
+void tick_remaining(uint32_t *remaining, uint32_t now, uint32_t since, unsigned int seconds) {
+    if (seconds == 0) {
+        return;
+    }
+    uint32_t elapsed = now - since;
+    uint32_t limit = SECONDS_TO_TICKS(seconds);
+    uint32_t left = elapsed < limit ? limit - elapsed : 0;
+    if (left < *remaining) {
+        *remaining = left;
+    }
+}
+
+// Memasang timer sesi pada tenggat terdekat: batas login, PING berikutnya,
+// batas idle, atau batas antrian macet. Hanya satu timer per sesi; aktivitas
+// klien tidak menggeser timer, cukup mencatat tick-nya, dan timer yang
+// berbunyi terlalu awal menghitung ulang tenggatnya sendiri.
+void session_schedule(struct shard *shard, struct session *session) {
+    uint32_t now = (uint32_t)shard->tick;
+    uint32_t remaining = UINT32_MAX;
+    if (session->user == NULL) {
+        tick_remaining(&remaining, now, session->connected_tick, config.login_timeout);
+    }
+    tick_remaining(&remaining, now, session->recv_tick, config.idle_timeout);
+    // PING berikutnya dihitung dari data terakhir atau PING terakhir
+    uint32_t quiet_since = (int32_t)(session->ping_tick - session->recv_tick) > 0 ? session->ping_tick : session->recv_tick;
+    tick_remaining(&remaining, now, quiet_since, config.ping_interval);
+    if (session->queue.bytes > 0) {
+        tick_remaining(&remaining, now, session->stall_tick, config.write_stall);
+    }
+
+    if (remaining == UINT32_MAX) {
+        timer_cancel(&shard->timers, session->fd);
+    } else if (timer_schedule(&shard->timers, session->fd, shard->tick + remaining) < 0) {
+        perror("timer_schedule");
+    }
+}
+
+// Memutus sesi yang melewati batas waktu
+void evict_client(struct shard *shard, struct session *session, const char *reason) {
+    fprintf(stderr, "[WARN] Klien fd %d diputus: %s\n", session->fd, reason);
+    log_message("WARN", session->user != NULL ? session->user->name : NULL, reason);
+    metric_add(&shard->metrics->timeouts, 1);
+    close_client(shard, session->fd);
+}
+
+// Mengirim PING ke klien yang diam. Semua sesi yang berbunyi pada tick yang
+// sama memakai satu buffer frame bersama.
+int send_ping(struct shard *shard, struct session *session) {
+    if (shard->ping == NULL || shard->ping_built_at != shard->tick) {
+        if (shard->ping != NULL) {
+            chat_buffer_release(shard->ping);
+        }
+        uint64_t stamp = metrics_now();
+        shard->ping = chat_buffer_frame(FRAME_PING, &stamp, sizeof(stamp));
+        if (shard->ping == NULL) {
+            perror("malloc");
+            return 0;
+        }
+        shard->ping_built_at = shard->tick;
+    }
+    session->ping_tick = (uint32_t)shard->tick;
+    return queue_frame(shard, session, shard->ping);
+}
+
+// Callback timing wheel untuk sesi fd
+void session_timer_fired(void *ctx, int fd) {
+    struct shard *shard = ctx;
+    struct session *session = session_get(&shard->sessions, fd);
+    if (session == NULL) {
+        return;
+    }
+    uint32_t now = (uint32_t)shard->tick;
+
+    if (session->user == NULL && tick_expired(now, session->connected_tick, config.login_timeout)) {
+        evict_client(shard, session, "Login tidak selesai dalam batas waktu.");
+        return;
+    }
+    if (tick_expired(now, session->recv_tick, config.idle_timeout)) {
+        evict_client(shard, session, "Tidak ada data maupun PONG dalam batas waktu idle.");
+        return;
+    }
+    if (session->queue.bytes > 0 && tick_expired(now, session->stall_tick, config.write_stall)) {
+        evict_client(shard, session, "Antrian kirim tidak berkurang dalam batas waktu.");
+        return;
+    }
+    if (tick_expired(now, session->recv_tick, config.ping_interval) &&
+        tick_expired(now, session->ping_tick, config.ping_interval)) {
+        if (send_ping(shard, session) < 0) {
+            return; // Klien diputus kebijakan slow consumer
+        }
+    }
+    session_schedule(shard, session);
+}
+
+// Memajukan timing wheel ke tick iterasi ini. Hanya timer yang jatuh tempo
+// yang disentuh, bukan seluruh sesi.
+void shard_run_timers(struct shard *shard) {
+    timer_advance(&shard->timers, shard->tick, session_timer_fired, shard);
+}
+
+// Timeout event loop sampai timer berikutnya dalam milidetik, -1 jika tidak ada
+int shard_timer_timeout(struct shard *shard) {
+    uint64_t next = timer_next_tick(&shard->timers);
+    if (next == UINT64_MAX) {
+        return -1;
+    }
+    uint64_t now = metrics_now();
+    uint64_t at = next * TIMER_TICK_NS;
+    return at > now ? (int)((at - now + 999999) / 1000000) : 0;
+}
+
+// Membangunkan shard tujuan. Hanya satu write(eventfd) selama shard belum bangun.
+// Mengembalikan jumlah syscall yang dilakukan (0 atau 1).
+int shard_wake(struct shard *shard) {
+    if (atomic_exchange(&shard->wake_pending, 1)) {
+        return 0;
+    }
+    uint64_t one = 1;
+    if (write(shard->wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        perror("eventfd write");
+    }
+    return 1;
+}
+
+// Mengirim pesan dari shard lain ke klien lokal yang dituju
+void deliver_shard_message(struct shard *shard, const struct shard_message *msg) {
+    if (msg->kind == SHARD_MSG_ROOM) {
+        struct room *room = room_find(&shard->rooms, msg->target, msg->target_len);
+        if (room != NULL && room_broadcast_local(shard, room, -1, msg->buf) > 0) {
+            note_delivery(shard, msg->received_at);
         }
     } else {
-        buffer[bytes_received] = '\0';
-
-        // Jika pesan adalah username
-        if (strncmp(buffer, "USERNAME:", 9) == 0) {
-            char *username = buffer + 9; // Ambil username setelah "USERNAME:"
-            username[strcspn(username, "\n")] = '\0'; // Hilangkan karakter newline
-            for (int i = 0; i < FD_SETSIZE; i++) {
-                if (client_sockets[i] == client_fd) {
-                    strncpy(client_usernames[i], username, BUFFER_SIZE);
-                    char connect_message[BUFFER_SIZE];
-                    snprintf(connect_message, sizeof(connect_message), "Klien %s terhubung.", username);
-                    log_message("INFO", NULL, connect_message);
-                    printf("[INFO] %s\n", connect_message);
-                    break;
-                }
-            }
-        } else {
-            // Ambil username pengirim
-            char sender_username[BUFFER_SIZE] = "Unknown";
-            for (int i = 0; i < FD_SETSIZE; i++) {
-                if (client_sockets[i] == client_fd) {
-                    strncpy(sender_username, client_usernames[i], BUFFER_SIZE - 1);
-                    break;
-                }
-            }
+        struct session *session = session_find_user(&shard->sessions, msg->target, msg->target_len);
+        if (session != NULL && queue_frame(shard, session, msg->buf) == 0) {
+            note_delivery(shard, msg->received_at);
+        }
+    }
+}
 
-            // Log pesan dengan username
-            log_message("CHAT", sender_username, buffer);
+// Memproses semua pesan dari shard lain yang ada di inbox
+void shard_drain_inbox(struct shard *shard) {
+    struct shard_message msg;
+    while (chat_ring_pop(&shard->inbox, &msg)) {
+        deliver_shard_message(shard, &msg);
+        chat_buffer_release(msg.buf);
+    }
+}
 
-            // Tampilkan pesan di server
-            printf("[CHAT] %s: %s\n", sender_username, buffer);
+// Meneruskan frame ke inbox shard lain yang ada di targets (shard yang punya
+// anggota room atau pemilik username menurut direktori global). Setiap shard
+// tujuan memegang satu referensi dan melepasnya setelah frame masuk ke
+// antrian kliennya.
+void shard_forward(struct shard *shard, const struct shard_mask *targets, unsigned char kind, const char *target,
+                   size_t target_len, struct chat_buffer *buf, uint64_t received_at) {
+    struct shard_message msg;
+    msg.buf = buf;
+    msg.received_at = received_at;
+    msg.kind = kind;
+    msg.target_len = (unsigned char)target_len;
+    memcpy(msg.target, target, target_len);
 
-            // Broadcast pesan ke klien lain
-            char full_message[BUFFER_SIZE + BUFFER_SIZE];
-            snprintf(full_message, sizeof(full_message), "[CHAT] [%s]: %s", sender_username, buffer);
-            broadcast_message(client_fd, full_message);
+    for (int i = 0; i < config.num_shards; i++) {
+        struct shard *dest = shards[i];
+        if (dest == shard || !shard_mask_test(targets, i)) {
+            continue;
         }
+        // Jika inbox tujuan penuh, kosongkan inbox sendiri sambil menunggu agar
+        // dua shard yang saling mengirim tidak terkunci satu sama lain.
+        chat_buffer_retain(buf);
+        while (!chat_ring_push(&dest->inbox, &msg)) {
+            metric_add(&shard->metrics->syscalls, shard_wake(dest));
+            shard_drain_inbox(shard);
+            sched_yield();
+        }
+        metric_add(&shard->metrics->syscalls, shard_wake(dest));
     }
 }
 
-void handle_new_connection(int new_socket) {
-    while (1) {
-        handle_client_message(new_socket);
+// Fungsi untuk broadcast pesan ke semua anggota room. Frame CHAT di-encode
+// sekali ke satu buffer ber-refcount lalu dipakai bersama oleh semua penerima
+// di semua shard.
+void broadcast_message(struct shard *shard, int sender_fd, const char *sender_username, struct room *room,
+                       const char *text, size_t text_len, uint64_t received_at) {
+    size_t name_len = strnlen(sender_username, CHAT_USERNAME_MAX);
+    size_t payload_len = 1 + name_len + 1 + room->len + text_len;
+
+    struct chat_buffer *buf = chat_buffer_alloc(CHAT_FRAME_HEADER_SIZE + payload_len);
+    if (buf == NULL) {
+        perror("malloc");
+        return;
     }
+
+    char *p = buf->data;
+    chat_frame_header(p, FRAME_CHAT, (uint32_t)payload_len);
+    p += CHAT_FRAME_HEADER_SIZE;
+    *p++ = (char)name_len;
+    memcpy(p, sender_username, name_len);
+    p += name_len;
+    *p++ = (char)room->len;
+    memcpy(p, room->name, room->len);
+    p += room->len;
+    memcpy(p, text, text_len);
+
+    // Disimpan ke journal sebelum dikirim agar urutan riwayat sama dengan urutan broadcast
+    if (journal_append(room->name, room->len, buf) < 0) {
+        fprintf(stderr, "[WARN] Gagal menyimpan pesan #%s ke journal\n", room->name);
+    }
+
+    // Nama room dan shard tujuannya disalin dulu karena room bisa dihapus
+    // selama broadcast lokal
+    char room_name[CHAT_ROOM_MAX];
+    size_t room_len = room->len;
+    memcpy(room_name, room->name, room_len);
+    struct shard_mask targets;
+    room_shards(room, &targets);
+
+    // Anggota di shard ini dikirimi langsung, anggota di shard lain lewat inbox masing-masing
+    if (room_broadcast_local(shard, room, sender_fd, buf) > 0) {
+        note_delivery(shard, received_at);
+    }
+    shard_forward(shard, &targets, SHARD_MSG_ROOM, room_name, room_len, buf, received_at);
+    chat_buffer_release(buf);
 }
 
-int main() {
-    int server_fd, new_socket;
-    struct sockaddr_in address;
-    int opt = 1;
-    int addrlen = sizeof(address);
+// Mengirim pesan langsung ke satu pengguna, dicari lewat indeks username
+void direct_message(struct shard *shard, struct session *session, const char *target, size_t target_len,
+                    const char *text, size_t text_len, uint64_t received_at) {
+    const char *sender_username = session_name(session);
+    size_t name_len = strlen(sender_username);
+    size_t payload_len = 1 + name_len + text_len;
 
-    // Membuat socket file descriptor
-    if ((server_fd = socket(AF_INET, SOCK_STREAM, 0)) == 0) {
-        perror("socket failed");
-        exit(EXIT_FAILURE);
+    struct chat_buffer *buf = chat_buffer_alloc(CHAT_FRAME_HEADER_SIZE + payload_len);
+    if (buf == NULL) {
+        perror("malloc");
+        return;
     }
+    char *p = buf->data;
+    chat_frame_header(p, FRAME_DIRECT, (uint32_t)payload_len);
+    p += CHAT_FRAME_HEADER_SIZE;
+    *p++ = (char)name_len;
+    memcpy(p, sender_username, name_len);
+    p += name_len;
+    memcpy(p, text, text_len);
 
-    // Mengatur socket untuk memungkinkan multiple connections
-    if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt))) {
-        perror("setsockopt");
-        exit(EXIT_FAILURE);
+    struct session *recipient = session_find_user(&shard->sessions, target, target_len);
+    struct shard_mask owners;
+    if (recipient != NULL) {
+        if (queue_frame(shard, recipient, buf) == 0) {
+            note_delivery(shard, received_at);
+        }
+    } else if (config.num_shards > 1 && session_directory_find(target, target_len, &owners) == 0) {
+        // Tidak ada di shard ini: hanya shard pemilik username yang menerimanya
+        shard_forward(shard, &owners, SHARD_MSG_DIRECT, target, target_len, buf, received_at);
+    } else {
+        send_notice(shard, session, "Pengguna %.*s tidak ditemukan.", (int)target_len, target);
     }
+    chat_buffer_release(buf);
+}
 
-    address.sin_family = AF_INET;
-    address.sin_addr.s_addr = INADDR_ANY;
-    address.sin_port = htons(8080);
+// Mengirim pesan terakhir room dari journal ke klien yang baru masuk. Frame
+// dikirim langsung dari halaman journal yang di-mmap, tanpa salinan.
+void send_history(struct shard *shard, struct session *session, struct room *room) {
+    struct chat_buffer *history[JOURNAL_HISTORY_MAX];
+    size_t count = journal_replay(room->name, room->len, config.history, history);
+    for (size_t i = 0; i < count; i++) {
+        // Jika klien diputus di tengah jalan, sisa buffer tetap harus dilepas
+        if (session != NULL && queue_frame(shard, session, history[i]) < 0) {
+            session = NULL;
+        }
+        chat_buffer_release(history[i]);
+    }
+}
 
-    // Binding socket ke port 8080
-    if (bind(server_fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
-        perror("bind failed");
-        exit(EXIT_FAILURE);
+// Nama room hanya boleh berisi karakter yang bisa dicetak, tanpa spasi
+int valid_room_name(const char *name, size_t len) {
+    if (len == 0 || len > CHAT_ROOM_MAX) {
+        return 0;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (name[i] <= ' ' || name[i] == 0x7f) {
+            return 0;
+        }
     }
+    return 1;
+}
 
-    // Mendengarkan koneksi
-    if (listen(server_fd, 3) < 0) {
-        perror("listen");
-        exit(EXIT_FAILURE);
+// Username: 1-CHAT_USERNAME_MAX karakter alfanumerik atau '_', sama dengan
+// aturan klien. Nama ini masuk ke log dan journal, jadi karakter kontrol dan
+// spasi tidak boleh lolos.
+int valid_username(const char *name, size_t len) {
+    if (len == 0 || len > CHAT_USERNAME_MAX) {
+        return 0;
     }
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)name[i];
+        if (!isalnum(c) && c != '_') {
+            return 0;
+        }
+    }
+    return 1;
+}
 
-    printf("Listening on port 8080\n");
+// Kapasitas bucket byte: minimal satu frame terbesar agar frame sebesar
+// --max-message tetap bisa lewat
+double byte_burst(void) {
+    double burst = config.byte_rate * RATE_BURST_S;
+    double frame = (double)(CHAT_FRAME_HEADER_SIZE + config.max_message);
+    return burst > frame ? burst : frame;
+}
 
-    while (1) {
-        if ((new_socket = accept(server_fd, (struct sockaddr *)&address, (socklen_t *)&addrlen)) < 0) {
-            perror("accept");
-            exit(EXIT_FAILURE);
+// Memberi tahu klien bahwa frame-nya dibuang. Klien yang terus mengirim hanya
+// mendapat satu THROTTLE (dan satu baris log) per THROTTLE_NOTICE_S detik.
+void throttle_client(struct shard *shard, struct session *session, double wait_seconds, const char *reason) {
+    uint32_t now = (uint32_t)shard->tick;
+    if (session->throttled && !tick_expired(now, session->throttle_tick, THROTTLE_NOTICE_S)) {
+        return;
+    }
+    session->throttled = 1;
+    session->throttle_tick = now;
+    fprintf(stderr, "[WARN] Klien fd %d dibatasi: %s\n", session->fd, reason);
+    log_message("WARN", session->user != NULL ? session->user->name : NULL, reason);
+
+    char payload[128];
+    uint32_t retry_after_ms = (uint32_t)(wait_seconds * 1000.0) + 1;
+    size_t len = chat_retry_payload(payload, sizeof(payload), retry_after_ms, reason);
+    struct chat_buffer *buf = chat_buffer_frame(FRAME_THROTTLE, payload, len);
+    if (buf == NULL) {
+        perror("malloc");
+        return;
+    }
+    queue_frame(shard, session, buf);
+    chat_buffer_release(buf);
+}
+
+// FNV-1a 64 bit untuk filter duplikat, bisa dilanjutkan dari hash sebelumnya
+uint64_t payload_hash(uint64_t hash, const char *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Batas laju dan filter duplikat untuk frame dari klien, diperiksa sebelum
+// frame diformat, dicatat, atau disebarkan. Setiap frame memakai satu token
+// pesan dan token byte sebesar ukuran frame; frame CHAT/DIRECT yang payload-nya
+// sama dengan salah satu payload terakhir dalam --dup-window juga dibuang.
+// Heartbeat tidak dibatasi agar klien yang di-throttle tidak ikut diputus.
+// Mengembalikan 1 jika frame dibuang.
+int frame_limited(struct shard *shard, struct session *session, const struct chat_frame *frame, uint64_t now) {
+    if (frame->type == FRAME_PING || frame->type == FRAME_PONG) {
+        return 0;
+    }
+
+    double elapsed = (double)(now - session->refill_at) / 1e9;
+    session->refill_at = now;
+    double size = (double)(CHAT_FRAME_HEADER_SIZE + frame->length);
+    if (config.msg_rate > 0) {
+        session->msg_tokens += elapsed * config.msg_rate;
+        if (session->msg_tokens > config.msg_rate * RATE_BURST_S) {
+            session->msg_tokens = config.msg_rate * RATE_BURST_S;
+        }
+        if (session->msg_tokens < 1.0) {
+            metric_add(&shard->metrics->throttled, 1);
+            throttle_client(shard, session, (1.0 - session->msg_tokens) / config.msg_rate,
+                            "Terlalu banyak pesan, pesan dibuang.");
+            return 1;
+        }
+    }
+    if (config.byte_rate > 0) {
+        session->byte_tokens += elapsed * config.byte_rate;
+        if (session->byte_tokens > byte_burst()) {
+            session->byte_tokens = byte_burst();
+        }
+        if (session->byte_tokens < size) {
+            metric_add(&shard->metrics->throttled, 1);
+            throttle_client(shard, session, (size - session->byte_tokens) / config.byte_rate,
+                            "Terlalu banyak data, pesan dibuang.");
+            return 1;
         }
+        session->byte_tokens -= size;
+    }
+    if (config.msg_rate > 0) {
+        session->msg_tokens -= 1.0;
+    }
 
-        printf("New connection, socket fd is %d, ip is : %s, port : %d\n", new_socket, inet_ntoa(address.sin_addr), ntohs(address.sin_port));
+    if (config.dup_window == 0 || (frame->type != FRAME_CHAT && frame->type != FRAME_DIRECT)) {
+        return 0;
+    }
+    // Pesan yang sama ke room lain bukan duplikat
+    char type = (char)frame->type;
+    uint64_t hash = payload_hash(14695981039346656037ull, &type, 1);
+    if (frame->type == FRAME_CHAT && session->active_room != NULL) {
+        hash = payload_hash(hash, session->active_room->name, session->active_room->len + 1);
+    }
+    hash = payload_hash(hash, frame->payload, frame->length);
+    uint32_t tick = (uint32_t)shard->tick;
+    for (int i = 0; i < SESSION_RECENT_PAYLOADS; i++) {
+        if (session->recent_hash[i] == hash && session->recent_len[i] == frame->length &&
+            !tick_expired(tick, session->recent_tick[i], config.dup_window)) {
+            // Pengulangan terus-menerus menggeser jendelanya
+            session->recent_tick[i] = tick;
+            metric_add(&shard->metrics->duplicates, 1);
+            throttle_client(shard, session, config.dup_window, "Pesan yang sama baru saja dikirim, pesan dibuang.");
+            return 1;
+        }
+    }
+    session->recent_hash[session->recent_next] = hash;
+    session->recent_len[session->recent_next] = frame->length;
+    session->recent_tick[session->recent_next] = tick;
+    session->recent_next = (session->recent_next + 1) % SESSION_RECENT_PAYLOADS;
+    return 0;
+}
 
-        for (int i = 0; i < FD_SETSIZE; i++) {
-            if (client_sockets[i] == 0) {
-                client_sockets[i] = new_socket;
-                break;
+// Memproses satu frame utuh dari klien
+void handle_frame(struct shard *shard, struct session *session, const struct chat_frame *frame, uint64_t received_at) {
+    int client_fd = session->fd;
+    if (frame_limited(shard, session, frame, received_at)) {
+        return;
+    }
+    // Room dan pesan langsung hanya untuk sesi yang sudah login, agar LOGIN
+    // selalu memasukkan klien ke room default beserta riwayatnya
+    if (session->user == NULL && (frame->type == FRAME_CHAT || frame->type == FRAME_JOIN ||
+                                  frame->type == FRAME_LEAVE || frame->type == FRAME_LIST ||
+                                  frame->type == FRAME_DIRECT)) {
+        send_notice(shard, session, "Silakan login terlebih dahulu.");
+        return;
+    }
+    switch (frame->type) {
+    case FRAME_LOGIN: {
+        // Payload frame login adalah username; nama tidak bisa diganti setelah login
+        if (session->user != NULL) {
+            send_notice(shard, session, "Anda sudah login sebagai %s.", session->user->name);
+            break;
+        }
+        if (!valid_username(frame->payload, frame->length)) {
+            send_notice(shard, session, "Username tidak valid. Harus 1-%d karakter alfanumerik atau '_'.", CHAT_USERNAME_MAX);
+            break;
+        }
+        if (session_set_username(&shard->sessions, session, frame->payload, frame->length) < 0) {
+            perror("malloc");
+            break;
+        }
+
+        char connect_message[BUFFER_SIZE];
+        snprintf(connect_message, sizeof(connect_message), "Klien %s terhubung.", session->user->name);
+        log_message("INFO", NULL, connect_message);
+        printf("[INFO] %s\n", connect_message);
+
+        // Setiap klien otomatis masuk ke room default dan menerima riwayatnya
+        struct room *room;
+        if (session->room_count == 0) {
+            if (room_join(&shard->rooms, session, CHAT_DEFAULT_ROOM, strlen(CHAT_DEFAULT_ROOM), &room) < 0) {
+                perror("room_join");
+            } else {
+                send_history(shard, session, room);
             }
         }
+        break;
+    }
+    case FRAME_CHAT: {
+        if (session->active_room == NULL) {
+            send_notice(shard, session, "Anda belum bergabung ke room mana pun.");
+            break;
+        }
 
-        pid_t pid = fork();
-        if (pid == 0) {
-            // Child process
-            close(server_fd);
-            handle_new_connection(new_socket);
-            exit(0);
-        } else if (pid < 0) {
-            perror("fork failed");
-            exit(EXIT_FAILURE);
+        // Ambil username pengirim
+        const char *sender_username = session_name(session);
+        struct room *room = session->active_room;
+
+        // Log pesan dengan username (room selain default ditandai di depan pesan)
+        if (strcmp(room->name, CHAT_DEFAULT_ROOM) == 0) {
+            log_message_len("CHAT", sender_username, frame->payload, frame->length);
+        } else {
+            char text[BUFFER_SIZE];
+            int len = snprintf(text, sizeof(text), "[#%s] %.*s", room->name, (int)frame->length, frame->payload);
+            log_message_len("CHAT", sender_username, text, len < (int)sizeof(text) ? (size_t)len : sizeof(text) - 1);
+        }
+
+        // Tampilkan pesan di server
+        printf("[CHAT] #%s %s: %.*s\n", room->name, sender_username, (int)frame->length, frame->payload);
+
+        // Broadcast pesan ke anggota room yang lain
+        broadcast_message(shard, client_fd, sender_username, room, frame->payload, frame->length, received_at);
+        break;
+    }
+    case FRAME_JOIN: {
+        if (!valid_room_name(frame->payload, frame->length)) {
+            send_notice(shard, session, "Nama room tidak valid.");
+            break;
+        }
+        struct room *room;
+        int rc = room_join(&shard->rooms, session, frame->payload, frame->length, &room);
+        if (rc == -2) {
+            send_notice(shard, session, "Maksimum %d room per klien.", SESSION_MAX_ROOMS);
+        } else if (rc < 0) {
+            perror("room_join");
+        } else {
+            send_notice(shard, session, "Room aktif: #%s", room->name);
+            // Selama sesi masih ada, room-nya juga masih ada (sesi adalah anggotanya)
+            session = session_get(&shard->sessions, client_fd);
+            if (rc == 0 && session != NULL) {
+                send_history(shard, session, room);
+            }
+        }
+        break;
+    }
+    case FRAME_LEAVE: {
+        struct room *room = room_find(&shard->rooms, frame->payload, frame->length);
+        if (room == NULL || room_leave(&shard->rooms, session, room) < 0) {
+            send_notice(shard, session, "Anda tidak berada di room %.*s.", (int)frame->length, frame->payload);
+        } else if (session->active_room != NULL) {
+            send_notice(shard, session, "Keluar dari room. Room aktif: #%s", session->active_room->name);
+        } else {
+            send_notice(shard, session, "Keluar dari room. Anda tidak berada di room mana pun.");
         }
+        break;
     }
+    case FRAME_LIST: {
+        char list[BUFFER_SIZE];
+        size_t len = room_directory_list(list, sizeof(list));
+        struct chat_buffer *buf = chat_buffer_frame(FRAME_CONTROL, list, len);
+        if (buf != NULL) {
+            queue_frame(shard, session, buf);
+            chat_buffer_release(buf);
+        }
+        break;
+    }
+    case FRAME_DIRECT: {
+        size_t offset = 0;
+        const char *target;
+        int target_len = chat_read_field(frame->payload, frame->length, &offset, &target);
+        if (target_len <= 0 || target_len > CHAT_USERNAME_MAX) {
+            send_notice(shard, session, "Format pesan langsung tidak valid.");
+            break;
+        }
+        const char *text = frame->payload + offset;
+        size_t text_len = frame->length - offset;
 
+        char log_text[BUFFER_SIZE];
+        int len = snprintf(log_text, sizeof(log_text), "@%.*s %.*s", target_len, target, (int)text_len, text);
+        log_message_len("DM", session_name(session), log_text, len < (int)sizeof(log_text) ? (size_t)len : sizeof(log_text) - 1);
+
+        direct_message(shard, session, target, target_len, text, text_len, received_at);
+        break;
+    }
+    case FRAME_PING: {
+        // Klien memeriksa koneksinya: balas dengan data yang sama
+        if (frame->length > CHAT_PING_MAX) {
+            break;
+        }
+        struct chat_buffer *pong = chat_buffer_frame(FRAME_PONG, frame->payload, frame->length);
+        if (pong == NULL) {
+            perror("malloc");
+            break;
+        }
+        queue_frame(shard, session, pong);
+        chat_buffer_release(pong);
+        break;
+    }
+    case FRAME_PONG:
+        // Aktivitas klien sudah dicatat saat datanya diterima
+        break;
+    default:
+        fprintf(stderr, "[WARN] Tipe frame %u dari fd %d diabaikan\n", frame->type, client_fd);
+        break;
+    }
+}
+
+// Memproses semua frame utuh yang sudah ada di buffer parser klien.
+// Mengembalikan -1 jika klien diputus (sesi sudah dihapus).
+int handle_client_frames(struct shard *shard, int client_fd, uint64_t received_at) {
+    struct session *session = session_get(&shard->sessions, client_fd);
+    if (session == NULL) {
+        return -1;
+    }
+    struct chat_parser *parser = &session->parser;
+    session->recv_tick = (uint32_t)shard->tick;
+
+    struct chat_frame frame;
+    int rc;
+    while ((rc = chat_parser_next(parser, &frame)) == 1) {
+        metric_add(&shard->metrics->frames_in, 1);
+        handle_frame(shard, session, &frame, received_at);
+        // Sesi dicari ulang karena pemrosesan frame bisa memindahkan posisi
+        // sesi di tabel
+        session = session_get(&shard->sessions, client_fd);
+        if (session == NULL) {
+            return -1; // Klien diputus saat frame diproses
+        }
+        parser = &session->parser;
+    }
+    if (rc < 0) {
+        log_message("WARN", NULL, "Frame tidak valid atau terlalu besar, koneksi diputus.");
+        fprintf(stderr, "[WARN] Frame tidak valid dari fd %d, koneksi diputus\n", client_fd);
+        close_client(shard, client_fd);
+        return -1;
+    }
+    return 0;
+}
+
+// Callback EPOLLIN untuk socket klien. Karena epoll dipasang edge-triggered,
+// socket harus dibaca sampai EAGAIN agar tidak ada data yang tertinggal.
+// Satu recv() besar bisa berisi banyak frame sekaligus, atau hanya sebagian frame.
+void handle_client_message(struct shard *shard, int client_fd) {
+    while (1) {
+        struct session *session = session_get(&shard->sessions, client_fd);
+        if (session == NULL) {
+            return;
+        }
+        struct chat_parser *parser = &session->parser;
+
+        size_t space;
+        char *dst = chat_parser_write_ptr(parser, &space);
+        if (dst == NULL) {
+            perror("Gagal memperbesar buffer klien");
+            close_client(shard, client_fd);
+            return;
+        }
+
+        ssize_t bytes_received = recv(client_fd, dst, space, 0);
+        metric_add(&shard->metrics->syscalls, 1);
+        if (bytes_received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return; // Semua data sudah dibaca
+            }
+            perror("Gagal menerima pesan");
+            close_client(shard, client_fd);
+            return;
+        }
+        if (bytes_received == 0) {
+            // Handle disconnect
+            close_client(shard, client_fd);
+            return;
+        }
+        chat_parser_commit(parser, bytes_received);
+        metric_add(&shard->metrics->bytes_in, bytes_received);
+        if (handle_client_frames(shard, client_fd, metrics_now()) < 0) {
+            return;
+        }
+    }
+}
+
+// Membuat sesi untuk koneksi baru. Jika gagal, socket ditutup dan NULL
+// dikembalikan.
+struct session *client_add(struct shard *shard, int client_fd) {
+    struct session *session = session_add(&shard->sessions, client_fd);
+    if (session == NULL) {
+        fprintf(stderr, "[WARN] Gagal menambah sesi, koneksi fd %d ditolak\n", client_fd);
+        close(client_fd);
+        return NULL;
+    }
+    if (chat_parser_init(&session->parser, config.max_message) < 0 ||
+        out_queue_init(&session->queue, config.out_queue_len) < 0) {
+        perror("malloc");
+        session_remove(&shard->sessions, client_fd);
+        close(client_fd);
+        return NULL;
+    }
+    session->generation = shard->next_generation++;
+    session->connected_tick = (uint32_t)shard->tick;
+    session->recv_tick = session->connected_tick;
+    session->ping_tick = session->connected_tick;
+    session->stall_tick = session->connected_tick;
+    session->msg_tokens = config.msg_rate * RATE_BURST_S;
+    session->byte_tokens = byte_burst();
+    session->refill_at = metrics_now();
+    session_schedule(shard, session);
+    atomic_fetch_add_explicit(&active_sessions, 1, memory_order_relaxed);
+    return session;
+}
+
+void client_connected(struct shard *shard, int client_fd, const struct sockaddr_in *address) {
+    metric_add(&shard->metrics->accepted, 1);
+    metric_set(&shard->metrics->sessions, shard->sessions.count);
+
+    printf("New connection on shard %d, socket fd is %d, ip is : %s, port : %d\n", shard->id, client_fd, inet_ntoa(address->sin_addr), ntohs(address->sin_port));
+}
+
+// Admission control: menolak koneksi baru saat server penuh atau laju koneksi
+// baru melewati batas. Klien yang ditolak langsung mendapat frame REJECT
+// berisi saran waktu tunggu, bukan timeout. 0 jika koneksi diterima; jika
+// ditolak, socket sudah ditutup.
+int admit_client(struct shard *shard, int client_fd) {
+    const char *reason = NULL;
+    uint32_t retry_after_ms = 0;
+
+    if (config.max_sessions > 0 &&
+        atomic_load_explicit(&active_sessions, memory_order_relaxed) >= config.max_sessions) {
+        reason = "Server penuh, coba lagi nanti.";
+        retry_after_ms = REJECT_RETRY_FULL_MS;
+    } else if (config.accept_rate > 0) {
+        // Setiap shard mendapat bagian laju yang sama, dengan burst satu detik
+        double rate = config.accept_rate / config.num_shards;
+        uint64_t now = metrics_now();
+        shard->accept_tokens += (double)(now - shard->accept_refill_at) / 1e9 * rate;
+        if (shard->accept_tokens > rate) {
+            shard->accept_tokens = rate;
+        }
+        shard->accept_refill_at = now;
+        if (shard->accept_tokens < 1.0) {
+            reason = "Terlalu banyak koneksi baru, coba lagi nanti.";
+            retry_after_ms = REJECT_RETRY_RATE_MS;
+        } else {
+            shard->accept_tokens -= 1.0;
+        }
+    }
+    if (reason == NULL) {
+        return 0;
+    }
+
+    // Frame LOGIN yang sudah masuk dibaca dulu agar close() mengirim FIN, bukan
+    // RST yang bisa membuat klien kehilangan frame REJECT
+    char frame[128];
+    size_t len = chat_reject_frame(frame, sizeof(frame), retry_after_ms, reason);
+    if (send(client_fd, frame, len, MSG_DONTWAIT | MSG_NOSIGNAL) < 0 && errno != EAGAIN) {
+        perror("send reject");
+    }
+    char discard[512];
+    recv(client_fd, discard, sizeof(discard), MSG_DONTWAIT);
+    close(client_fd);
+    metric_add(&shard->metrics->syscalls, 2);
+    metric_add(&shard->metrics->rejected, 1);
+    return -1;
+}
+
+// Callback EPOLLIN untuk socket listener. Paling banyak --accept-batch koneksi
+// diterima per panggilan agar badai reconnect tidak menahan klien yang sudah
+// terhubung; sisanya dilanjutkan di iterasi event loop berikutnya.
+void handle_new_connection(struct shard *shard) {
+    struct sockaddr_in address;
+    socklen_t addrlen = sizeof(address);
+
+    shard->accept_pending = 0;
+    for (unsigned int accepted = 0; accepted < config.accept_batch; accepted++) {
+        int new_socket = accept4(shard->server_fd, (struct sockaddr *)&address, &addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        metric_add(&shard->metrics->syscalls, 1);
+        if (new_socket < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("accept");
+            }
+            return;
+        }
+        addrlen = sizeof(address);
+
+        if (admit_client(shard, new_socket) < 0 || client_add(shard, new_socket) == NULL) {
+            continue;
+        }
+
+        // EPOLLOUT edge-triggered hanya muncul saat socket kembali bisa ditulis
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.fd = new_socket;
+        if (epoll_ctl(shard->epoll_fd, EPOLL_CTL_ADD, new_socket, &ev) < 0) {
+            perror("epoll_ctl");
+            timer_cancel(&shard->timers, new_socket);
+            session_remove(&shard->sessions, new_socket);
+            atomic_fetch_sub_explicit(&active_sessions, 1, memory_order_relaxed);
+            close(new_socket);
+            continue;
+        }
+        client_connected(shard, new_socket, &address);
+    }
+    // Batch habis sebelum EAGAIN: listener edge-triggered tidak akan memberi
+    // event lagi untuk koneksi yang sudah antre
+    shard->accept_pending = 1;
+}
+
+// Memasang recv multishot untuk klien: satu SQE terus menghasilkan completion
+// setiap kali data tiba, ke buffer yang dipilih kernel dari buffer ring
+int uring_arm_recv(struct shard *shard, struct session *session) {
+    uint64_t data = URING_DATA(URING_OP_RECV, session->generation, session->fd);
+    if (chat_uring_recv_multishot(shard->ring, session->fd, data) < 0) {
+        perror("io_uring recv");
+        close_client(shard, session->fd);
+        return -1;
+    }
+    return 0;
+}
+
+// Completion accept multishot: satu koneksi baru per completion
+void uring_handle_accept(struct shard *shard, const struct chat_uring_cqe *cqe) {
+    if (cqe->res < 0) {
+        errno = -cqe->res;
+        perror("accept");
+    } else {
+        int new_socket = cqe->res;
+        struct session *session = admit_client(shard, new_socket) == 0 ? client_add(shard, new_socket) : NULL;
+        if (session != NULL && uring_arm_recv(shard, session) == 0) {
+            struct sockaddr_in address;
+            socklen_t addrlen = sizeof(address);
+            memset(&address, 0, sizeof(address));
+            getpeername(new_socket, (struct sockaddr *)&address, &addrlen);
+            metric_add(&shard->metrics->syscalls, 1);
+            client_connected(shard, new_socket, &address);
+        }
+    }
+    // Kernel menghentikan multishot (misalnya karena error): pasang lagi
+    if (!(cqe->flags & CHAT_URING_MORE) &&
+        chat_uring_accept_multishot(shard->ring, shard->server_fd, URING_DATA(URING_OP_ACCEPT, 0, 0)) < 0) {
+        perror("io_uring accept");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Completion recv multishot. Data disalin dari buffer kernel ke parser sesi,
+// lalu buffer langsung dikembalikan ke buffer ring.
+void uring_handle_recv(struct shard *shard, const struct chat_uring_cqe *cqe) {
+    int client_fd = URING_DATA_VALUE(cqe->user_data);
+    struct session *session = session_get(&shard->sessions, client_fd);
+    if (session == NULL || (session->generation & 0xffffff) != URING_DATA_GENERATION(cqe->user_data)) {
+        // Completion terakhir dari sesi yang sudah ditutup (fd-nya mungkin
+        // sudah dipakai koneksi baru)
+        if (cqe->buffer >= 0) {
+            chat_uring_recycle(shard->ring, cqe->buffer);
+        }
+        return;
+    }
+
+    if (cqe->res > 0) {
+        const char *data = chat_uring_buffer(shard->ring, cqe->buffer);
+        size_t len = (size_t)cqe->res;
+        metric_add(&shard->metrics->bytes_in, len);
+        uint64_t received_at = metrics_now();
+        int alive = 1;
+        while (len > 0 && alive) {
+            session = session_get(&shard->sessions, client_fd);
+            size_t space;
+            char *dst = chat_parser_write_ptr(&session->parser, &space);
+            if (dst == NULL) {
+                perror("Gagal memperbesar buffer klien");
+                close_client(shard, client_fd);
+                alive = 0;
+                break;
+            }
+            size_t n = len < space ? len : space;
+            memcpy(dst, data, n);
+            chat_parser_commit(&session->parser, n);
+            data += n;
+            len -= n;
+            alive = handle_client_frames(shard, client_fd, received_at) == 0;
+        }
+        chat_uring_recycle(shard->ring, cqe->buffer);
+        if (!alive) {
+            return;
+        }
+    } else if (cqe->res == 0) {
+        close_client(shard, client_fd); // Handle disconnect
+        return;
+    } else if (cqe->res != -ENOBUFS) {
+        if (cqe->res != -ECONNRESET) {
+            errno = -cqe->res;
+            perror("Gagal menerima pesan");
+        }
+        close_client(shard, client_fd);
+        return;
+    }
+
+    // Buffer ring sempat habis (-ENOBUFS) atau kernel menghentikan multishot
+    if (!(cqe->flags & CHAT_URING_MORE)) {
+        session = session_get(&shard->sessions, client_fd);
+        uring_arm_recv(shard, session);
+    }
+}
+
+// Completion sendmsg: byte yang terkirim dilepas dari antrian, sisanya
+// dikirim di akhir iterasi ini
+void uring_handle_send(struct shard *shard, const struct chat_uring_cqe *cqe) {
+    struct uring_send *op = shard->sends[URING_DATA_VALUE(cqe->user_data)];
+    if (cqe->flags & CHAT_URING_NOTIF) {
+        // Kernel selesai memakai halaman buffer zero-copy
+        uring_send_put(shard, op);
+        return;
+    }
+
+    shard->send_pending--;
+    struct session *session = session_get(&shard->sessions, op->fd);
+    if (session != NULL && session->generation == op->generation) {
+        session->queue.inflight = 0;
+        if (cqe->res == -ECANCELED) {
+            // Dibatalkan untuk serah terima sebelum ada byte yang terkirim;
+            // antrian tetap utuh dan ikut masuk snapshot
+        } else if (cqe->res < 0) {
+            if (cqe->res != -EPIPE && cqe->res != -ECONNRESET) {
+                errno = -cqe->res;
+                perror("Gagal mengirim pesan");
+            }
+            close_client(shard, op->fd);
+        } else {
+            out_queue_consume(&session->queue, (size_t)cqe->res);
+            metric_add(&shard->metrics->bytes_out, (unsigned long)cqe->res);
+            if (cqe->res > 0) {
+                session->stall_tick = (uint32_t)shard->tick;
+            }
+            if (session->queue.count > 0) {
+                mark_flush(shard, session);
+            }
+        }
+    }
+    // Untuk zero-copy, buffer baru boleh dilepas setelah notifikasi
+    if (!(cqe->flags & CHAT_URING_MORE)) {
+        uring_send_put(shard, op);
+    }
+}
+
+// Completion read eventfd: ada pesan dari shard lain di inbox
+void uring_handle_wake(struct shard *shard, const struct chat_uring_cqe *cqe) {
+    if (cqe->res < 0 && cqe->res != -EINTR) {
+        errno = -cqe->res;
+        perror("eventfd read");
+    }
+    // Reset flag sebelum mengosongkan inbox agar tidak ada wakeup yang hilang
+    atomic_store(&shard->wake_pending, 0);
+    shard_drain_inbox(shard);
+    if (chat_uring_read(shard->ring, shard->wake_fd, &shard->wake_value, sizeof(shard->wake_value),
+                        URING_DATA(URING_OP_WAKE, 0, 0)) < 0) {
+        perror("io_uring read");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Memproses semua completion yang sudah ada di CQ
+unsigned int uring_process_completions(struct shard *shard) {
+    struct chat_uring_cqe cqe;
+    unsigned int count = 0;
+    while (chat_uring_next(shard->ring, &cqe)) {
+        count++;
+        switch (URING_DATA_OP(cqe.user_data)) {
+        case URING_OP_ACCEPT:
+            uring_handle_accept(shard, &cqe);
+            break;
+        case URING_OP_WAKE:
+            uring_handle_wake(shard, &cqe);
+            break;
+        case URING_OP_RECV:
+            uring_handle_recv(shard, &cqe);
+            break;
+        case URING_OP_SEND:
+            uring_handle_send(shard, &cqe);
+            break;
+        }
+    }
+    return count;
+}
+
+// Membuat listener untuk satu shard. SO_REUSEPORT membuat kernel membagi
+// koneksi masuk ke semua listener pada port yang sama.
+int create_listener(void) {
+    int server_fd;
+    struct sockaddr_in address;
+    int opt = 1;
+
+    // Membuat socket file descriptor
+    if ((server_fd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+        perror("socket failed");
+        return -1;
+    }
+
+    // Mengatur socket untuk memungkinkan multiple connections
+    if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) ||
+        setsockopt(server_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt))) {
+        perror("setsockopt");
+        close(server_fd);
+        return -1;
+    }
+
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(PORT);
+
+    // Binding socket ke port 8080
+    if (bind(server_fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        perror("bind failed");
+        close(server_fd);
+        return -1;
+    }
+
+    // Koneksi baru baru diserahkan ke accept() setelah klien mengirim data
+    // (frame LOGIN), jadi koneksi kosong tidak pernah membangunkan shard
+    if (config.defer_accept > 0 &&
+        setsockopt(server_fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &config.defer_accept, sizeof(config.defer_accept)) < 0) {
+        perror("setsockopt TCP_DEFER_ACCEPT");
+    }
+
+    // Mendengarkan koneksi. Antrian yang panjang menampung badai reconnect
+    // tanpa SYN yang dibuang.
+    if (listen(server_fd, config.backlog) < 0) {
+        perror("listen");
+        close(server_fd);
+        return -1;
+    }
+
+    if (set_nonblocking(server_fd) < 0) {
+        perror("fcntl");
+        close(server_fd);
+        return -1;
+    }
+    return server_fd;
+}
+
+// Menyiapkan listener, epoll, eventfd, dan inbox untuk satu shard. listener_fd
+// adalah listener yang diterima dari server lama, -1 untuk membuat baru.
+struct shard *shard_create(int id, int listener_fd) {
+    struct shard *shard = calloc(1, sizeof(*shard));
+    if (shard == NULL) {
+        perror("calloc");
+        return NULL;
+    }
+    shard->id = id;
+    shard->metrics = metrics_slot(id);
+    shard->send_free = -1;
+    atomic_init(&shard->wake_pending, 0);
+
+    if (chat_ring_init(&shard->inbox, SHARD_RING_SIZE, sizeof(struct shard_message)) < 0) {
+        perror("chat_ring_init");
+        free(shard);
+        return NULL;
+    }
+    if (session_table_init(&shard->sessions, id) < 0 || room_table_init(&shard->rooms, id) < 0) {
+        perror("session_table_init");
+        return NULL;
+    }
+    shard->tick = current_tick();
+    if (timer_wheel_init(&shard->timers, shard->tick) < 0) {
+        perror("timer_wheel_init");
+        return NULL;
+    }
+
+    if (listener_fd >= 0) {
+        shard->server_fd = listener_fd;
+        if (set_nonblocking(shard->server_fd) < 0) {
+            perror("fcntl");
+            return NULL;
+        }
+    } else {
+        shard->server_fd = create_listener();
+        if (shard->server_fd < 0) {
+            return NULL;
+        }
+    }
+
+    shard->wake_fd = eventfd(0, EFD_NONBLOCK);
+    if (shard->wake_fd < 0) {
+        perror("eventfd");
+        return NULL;
+    }
+
+    shard->epoll_fd = epoll_create1(0);
+    if (shard->epoll_fd < 0) {
+        perror("epoll_create1");
+        return NULL;
+    }
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.fd = shard->server_fd;
+    if (epoll_ctl(shard->epoll_fd, EPOLL_CTL_ADD, shard->server_fd, &ev) < 0) {
+        perror("epoll_ctl");
+        return NULL;
+    }
+    ev.events = EPOLLIN;
+    ev.data.fd = shard->wake_fd;
+    if (epoll_ctl(shard->epoll_fd, EPOLL_CTL_ADD, shard->wake_fd, &ev) < 0) {
+        perror("epoll_ctl");
+        return NULL;
+    }
+    return shard;
+}
+
+// Memasang sesi yang sudah ada di tabel ke backend shard: sesi dari server
+// lama setelah --takeover, atau sesi yang dilanjutkan setelah serah terima
+// gagal. Iterasi dari belakang karena sesi yang gagal dipasang dihapus dan
+// tempatnya diisi sesi terakhir yang sudah diperiksa.
+void shard_adopt_sessions(struct shard *shard) {
+    for (size_t i = shard->sessions.count; i-- > 0;) {
+        struct session *session = &shard->sessions.sessions[i];
+        int fd = session->fd;
+        // Flag O_NONBLOCK milik socket, jadi ikut dari server lama
+        int rc = shard->ring != NULL ? set_blocking(fd) : set_nonblocking(fd);
+        if (rc == 0 && shard->ring == NULL) {
+            struct epoll_event ev;
+            ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+            ev.data.fd = fd;
+            rc = epoll_ctl(shard->epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+        }
+        if (rc < 0) {
+            perror("Gagal memasang sesi");
+            close_client(shard, fd);
+            continue;
+        }
+        if (shard->ring != NULL && uring_arm_recv(shard, session) < 0) {
+            continue;
+        }
+        if (session->queue.count > 0) {
+            mark_flush(shard, session);
+        }
+    }
+}
+
+// Menyalin semua sesi shard ke snapshot serah terima. Per sesi: username,
+// room yang diikuti beserta room aktif, byte frame yang belum utuh di parser,
+// dan antrian kirim yang belum terkirim. fd klien dikumpulkan dengan urutan
+// yang sama. Tick heartbeat tidak ikut; server baru menghitung dari awal.
+void shard_snapshot(struct shard *shard) {
+    struct handoff_buffer *buf = &shard->snapshot;
+    handoff_buffer_init(buf);
+    shard->snapshot_count = shard->sessions.count;
+    shard->snapshot_fds = malloc((shard->snapshot_count > 0 ? shard->snapshot_count : 1) * sizeof(int));
+    if (shard->snapshot_fds == NULL) {
+        buf->failed = 1;
+        return;
+    }
+
+    for (size_t i = 0; i < shard->snapshot_count; i++) {
+        const struct session *session = &shard->sessions.sessions[i];
+        shard->snapshot_fds[i] = session->fd;
+
+        if (session->user != NULL) {
+            handoff_put_u8(buf, session->user->len);
+            handoff_put(buf, session->user->name, session->user->len);
+        } else {
+            handoff_put_u8(buf, 0);
+        }
+
+        uint8_t active = 0xff;
+        handoff_put_u8(buf, session->room_count);
+        for (unsigned int r = 0; r < session->room_count; r++) {
+            const struct room *room = session->rooms[r];
+            handoff_put_u8(buf, room->len);
+            handoff_put(buf, room->name, room->len);
+            if (room == session->active_room) {
+                active = (uint8_t)r;
+            }
+        }
+        handoff_put_u8(buf, active);
+
+        const struct chat_parser *parser = &session->parser;
+        handoff_put_u32(buf, (uint32_t)(parser->end - parser->start));
+        handoff_put(buf, parser->buffer + parser->start, parser->end - parser->start);
+
+        const struct out_queue *queue = &session->queue;
+        handoff_put_u32(buf, queue->count);
+        handoff_put_u32(buf, (uint32_t)queue->head_offset);
+        for (unsigned int k = 0; k < queue->count; k++) {
+            const struct chat_buffer *frame = queue->items[(queue->head + k) & (queue->capacity - 1)];
+            handoff_put_u32(buf, (uint32_t)frame->length);
+            handoff_put(buf, frame->data, frame->length);
+        }
+    }
+}
+
+// Menghentikan I/O io_uring shard sebelum snapshot. Ring memakai
+// DEFER_TASKRUN: recv dan accept multishot yang terpasang baru membaca socket
+// saat thread ini masuk ke io_uring_enter(), jadi cukup sendmsg yang masih
+// berjalan yang dibatalkan dan ditunggu hasilnya. Setelah itu shard tidak
+// masuk ring lagi; data baru tetap di socket untuk server baru, dan request
+// yang tersisa dibatalkan kernel saat proses ini berhenti. Membatalkan semua
+// recv justru mahal: kernel mencari setiap request secara linear, kuadratik
+// untuk puluhan ribu sesi.
+void uring_quiesce(struct shard *shard) {
+    shard->handoff = 1;
+    for (int i = 0; i < shard->send_count; i++) {
+        // Slot zero-copy yang hanya menunggu notifikasi tidak ditemukan lagi
+        // oleh kernel; pembatalannya cukup gagal tanpa efek
+        if (shard->sends[i]->count > 0 &&
+            chat_uring_cancel(shard->ring, URING_DATA(URING_OP_SEND, 0, i), URING_DATA(URING_OP_CANCEL, 0, 0)) < 0) {
+            perror("io_uring cancel");
+            exit(EXIT_FAILURE);
+        }
+    }
+    while (shard->send_pending > 0) {
+        if (chat_uring_submit_wait(shard->ring, 1, -1) < 0 && errno != EINTR && errno != EBUSY) {
+            perror("io_uring_enter");
+            exit(EXIT_FAILURE);
+        }
+        uring_process_completions(shard);
+    }
+
+    // Completion dari io_uring_enter() terakhir bisa masih tertahan di daftar
+    // overflow kernel (CQ penuh), padahal recv multishot-nya sudah mengambil
+    // data dari socket dan data itu tidak akan terbaca lagi oleh server baru.
+    // Ring dimasuki lagi tanpa menunggu sampai tidak ada completion baru, agar
+    // frame tersebut diproses dan ikut masuk snapshot.
+    do {
+        if (chat_uring_flush(shard->ring) < 0 && errno != EINTR && errno != EBUSY) {
+            perror("io_uring_enter");
+            exit(EXIT_FAILURE);
+        }
+    } while (uring_process_completions(shard) > 0);
+}
+
+// Bagian shard dari serah terima ke server baru. Mengembalikan 1 jika sesi
+// sudah diambil alih (thread berhenti tanpa menutup socket), 0 jika serah
+// terima gagal dan shard melanjutkan event loop.
+int shard_handoff(struct shard *shard) {
+    if (shard->ring != NULL) {
+        uring_quiesce(shard);
+    }
+
+    // Inbox tetap dikosongkan sambil menunggu: shard lain bisa saja tertahan
+    // di shard_forward() karena inbox shard ini penuh. Setelah semua shard
+    // berhenti tidak ada lagi pesan yang diteruskan, jadi isi inbox terakhir
+    // bisa masuk antrian sebelum snapshot.
+    atomic_fetch_add(&handoff_stopped, 1);
+    while (atomic_load(&handoff_stopped) < config.num_shards) {
+        shard_drain_inbox(shard);
+        sched_yield();
+    }
+    shard_drain_inbox(shard);
+    shard_snapshot(shard);
+    pthread_barrier_wait(&handoff_barrier);
+
+    // Thread utama mengirim snapshot dan menunggu konfirmasi server baru
+    pthread_barrier_wait(&handoff_barrier);
+    handoff_buffer_free(&shard->snapshot);
+    free(shard->snapshot_fds);
+    shard->snapshot_fds = NULL;
+    if (atomic_load(&handoff_result) > 0) {
+        return 1;
+    }
+
+    fprintf(stderr, "[WARN] Shard %d melanjutkan sesinya sendiri\n", shard->id);
+    if (shard->ring != NULL) {
+        // recv dan accept masih terpasang; hanya kiriman yang tertunda
+        // selama serah terima yang perlu dimulai lagi. Server baru mungkin
+        // sempat mengubah flag listener yang dipakai bersama.
+        shard->handoff = 0;
+        if (set_blocking(shard->server_fd) < 0) {
+            perror("fcntl");
+        }
+        for (size_t i = 0; i < shard->sessions.count; i++) {
+            struct session *session = &shard->sessions.sessions[i];
+            if (session->queue.count > 0) {
+                mark_flush(shard, session);
+            }
+        }
+    }
+    flush_pending_clients(shard);
+    return 0;
+}
+
+// Event loop epoll
+void shard_run_epoll(struct shard *shard) {
+    struct epoll_event events[MAX_EVENTS];
+    shard_adopt_sessions(shard);
+    while (1) {
+        // Selama masih ada koneksi antre, epoll hanya diperiksa tanpa menunggu.
+        // Selain itu tunggu paling lama sampai timer sesi berikutnya.
+        int n = epoll_wait(shard->epoll_fd, events, MAX_EVENTS, shard->accept_pending ? 0 : shard_timer_timeout(shard));
+        metric_add(&shard->metrics->syscalls, 1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait");
+            exit(EXIT_FAILURE);
+        }
+        shard->tick = current_tick();
+
+        int listener_ready = 0;
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == shard->server_fd) {
+                handle_new_connection(shard);
+                listener_ready = 1;
+            } else if (fd == shard->wake_fd) {
+                uint64_t count;
+                if (read(shard->wake_fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+                    perror("eventfd read");
+                }
+                metric_add(&shard->metrics->syscalls, 1);
+                // Reset flag sebelum mengosongkan inbox agar tidak ada wakeup yang hilang
+                atomic_store(&shard->wake_pending, 0);
+                shard_drain_inbox(shard);
+            } else if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                close_client(shard, fd);
+            } else {
+                // EPOLLRDHUP tetap dibaca agar data terakhir tidak hilang;
+                // recv() akan mengembalikan 0 setelahnya.
+                if (events[i].events & (EPOLLIN | EPOLLRDHUP)) {
+                    handle_client_message(shard, fd);
+                }
+                if (events[i].events & EPOLLOUT) {
+                    struct session *session = session_get(&shard->sessions, fd);
+                    if (session != NULL) {
+                        flush_client(shard, session);
+                    }
+                }
+            }
+        }
+        // Lanjutkan koneksi yang masih antre dari batch sebelumnya
+        if (shard->accept_pending && !listener_ready) {
+            handle_new_connection(shard);
+        }
+
+        shard_run_timers(shard);
+        flush_pending_clients(shard);
+        record_deliveries(shard);
+        if (atomic_load(&handoff_requested) && shard_handoff(shard)) {
+            return;
+        }
+    }
+}
+
+// Event loop io_uring. Setiap iterasi hanya satu io_uring_enter(): semua
+// sendmsg yang disiapkan di iterasi sebelumnya dikirim sekaligus dan
+// completion baru ditunggu. Broadcast ke N penerima menjadi N SQE dalam satu
+// syscall, bukan N writev().
+void shard_run_uring(struct shard *shard) {
+    if (chat_uring_accept_multishot(shard->ring, shard->server_fd, URING_DATA(URING_OP_ACCEPT, 0, 0)) < 0 ||
+        chat_uring_read(shard->ring, shard->wake_fd, &shard->wake_value, sizeof(shard->wake_value),
+                        URING_DATA(URING_OP_WAKE, 0, 0)) < 0) {
+        perror("io_uring");
+        exit(EXIT_FAILURE);
+    }
+    shard_adopt_sessions(shard);
+
+    while (1) {
+        // EBUSY: CQ penuh, completion harus diproses dulu sebelum submit lagi.
+        // ETIME: tidak ada completion sampai timer sesi berikutnya.
+        int timeout_ms = shard_timer_timeout(shard);
+        if (chat_uring_submit_wait(shard->ring, 1, timeout_ms < 0 ? -1 : (int64_t)timeout_ms * 1000000) < 0 &&
+            errno != EINTR && errno != EBUSY && errno != ETIME) {
+            perror("io_uring_enter");
+            exit(EXIT_FAILURE);
+        }
+        // Kiriman iterasi sebelumnya baru disubmit di io_uring_enter() di atas,
+        // jadi latensinya dicatat sekarang agar sebanding dengan writev() epoll.
+        // Kiriman yang langsung selesai membuat enter segera kembali.
+        record_deliveries(shard);
+        shard->tick = current_tick();
+        uring_process_completions(shard);
+
+        shard_run_timers(shard);
+        flush_pending_clients(shard);
+        metric_add(&shard->metrics->syscalls, chat_uring_take_syscalls(shard->ring));
+        if (atomic_load(&handoff_requested) && shard_handoff(shard)) {
+            return;
+        }
+    }
+}
+
+// Thread worker satu shard
+void *shard_run(void *arg) {
+    struct shard *shard = arg;
+
+    if (config.pin_cpus) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(shard->id % (ncpu > 0 ? ncpu : 1), &set);
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err != 0) {
+            fprintf(stderr, "[WARN] Gagal mengunci shard %d ke CPU: %s\n", shard->id, strerror(err));
+        }
+    }
+
+    // Ring dibuat di thread shard karena hanya thread ini yang boleh submit
+    if (config.backend == BACKEND_URING) {
+        shard->ring = chat_uring_create(URING_ENTRIES, URING_BUFFERS, URING_BUFFER_SIZE);
+        if (shard->ring == NULL) {
+            perror("io_uring");
+            fprintf(stderr, "[WARN] Shard %d memakai epoll\n", shard->id);
+        } else if (set_blocking(shard->server_fd) < 0 || set_blocking(shard->wake_fd) < 0) {
+            perror("fcntl");
+            exit(EXIT_FAILURE);
+        } else {
+            shard_run_uring(shard);
+            return NULL;
+        }
+    }
+    shard_run_epoll(shard);
+    return NULL;
+}
+
+// Kernel diam-diam memotong backlog listen() ke net.core.somaxconn
+void check_backlog(void) {
+    FILE *f = fopen("/proc/sys/net/core/somaxconn", "r");
+    if (f == NULL) {
+        return;
+    }
+    int somaxconn;
+    if (fscanf(f, "%d", &somaxconn) == 1 && somaxconn < config.backlog) {
+        fprintf(stderr, "[WARN] Backlog %d dibatasi net.core.somaxconn = %d\n", config.backlog, somaxconn);
+    }
+    fclose(f);
+}
+
+// Mengirim listener dan snapshot semua shard ke server baru. Dipanggil
+// setelah semua shard berhenti dan snapshot-nya siap.
+int handoff_transfer(int sock) {
+    struct handoff_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, HANDOFF_MAGIC, sizeof(header.magic));
+    header.version = HANDOFF_VERSION;
+    header.shard_count = (uint32_t)config.num_shards;
+    for (int i = 0; i < config.num_shards; i++) {
+        header.session_count += (uint32_t)shards[i]->snapshot_count;
+    }
+    if (handoff_send(sock, &header, sizeof(header)) < 0) {
+        return -1;
+    }
+    for (int i = 0; i < config.num_shards; i++) {
+        if (handoff_send_fds(sock, &shards[i]->server_fd, 1) < 0) {
+            return -1;
+        }
+    }
+
+    for (int i = 0; i < config.num_shards; i++) {
+        struct shard *shard = shards[i];
+        if (shard->snapshot.failed) {
+            fprintf(stderr, "[ERROR] Snapshot shard %d gagal dibuat\n", shard->id);
+            return -1;
+        }
+        struct handoff_shard_header shard_header;
+        memset(&shard_header, 0, sizeof(shard_header));
+        shard_header.session_count = (uint32_t)shard->snapshot_count;
+        shard_header.data_len = shard->snapshot.len;
+        if (handoff_send(sock, &shard_header, sizeof(shard_header)) < 0 ||
+            handoff_send(sock, shard->snapshot.data, shard->snapshot.len) < 0 ||
+            handoff_send_fds(sock, shard->snapshot_fds, shard->snapshot_count) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Melayani server baru yang terhubung ke socket serah terima. Semua shard
+// dihentikan, snapshot dikirim, lalu server ini menunggu konfirmasi. Jika
+// server baru gagal di tengah jalan, shard melanjutkan sesinya sendiri.
+// 0 jika sesi sudah diambil alih dan server ini harus berhenti.
+int serve_handoff(int sock) {
+    struct ucred cred;
+    socklen_t cred_len = sizeof(cred);
+    if (getsockopt(sock, SOL_SOCKET, SO_PEERCRED, &cred, &cred_len) < 0 || cred.uid != geteuid()) {
+        fprintf(stderr, "[WARN] Permintaan serah terima dari pengguna lain ditolak\n");
+        return -1;
+    }
+    handoff_set_timeout(sock, HANDOFF_TIMEOUT_MS);
+
+    uint64_t started = metrics_now();
+    printf("[INFO] Server baru terhubung, menyerahkan sesi...\n");
+    // Socket metrik dibuka lagi oleh server baru
+    metrics_stop();
+    atomic_store(&handoff_requested, 1);
+    for (int i = 0; i < config.num_shards; i++) {
+        shard_wake(shards[i]);
+    }
+    pthread_barrier_wait(&handoff_barrier);
+    // Semua shard sudah berhenti: sisa antrian journal ditulis dan journal
+    // ditahan sampai hasil serah terima diketahui, karena server baru membuka
+    // segmen yang sama setelah menerima snapshot
+    journal_flush();
+
+    size_t sessions = 0;
+    for (int i = 0; i < config.num_shards; i++) {
+        sessions += shards[i]->snapshot_count;
+    }
+    int rc = handoff_transfer(sock);
+    char ack;
+    if (rc == 0 && (handoff_recv(sock, &ack, 1) < 0 || ack != 'K')) {
+        rc = -1;
+    }
+    if (rc < 0) {
+        // Journal harus berjalan lagi sebelum shard melanjutkan sesinya
+        journal_resume();
+    }
+
+    atomic_store(&handoff_result, rc == 0 ? 1 : -1);
+    atomic_store(&handoff_stopped, 0);
+    atomic_store(&handoff_requested, 0);
+    pthread_barrier_wait(&handoff_barrier);
+
+    if (rc < 0) {
+        fprintf(stderr, "[WARN] Serah terima gagal, server ini tetap berjalan\n");
+        metrics_start(&config.metrics);
+        return -1;
+    }
+    printf("[INFO] %zu sesi diserahkan ke server baru dalam %.2f ms\n", sessions,
+           (double)(metrics_now() - started) / 1e6);
+    return 0;
+}
+
+// Terhubung ke server lama (--takeover) dan menerima header serta listener
+// semua shard. Jumlah shard mengikuti server lama karena setiap shard
+// menyerahkan listener SO_REUSEPORT-nya sendiri.
+int takeover_connect(int **listener_fds) {
+    int sock = handoff_connect(config.handoff_path);
+    if (sock < 0) {
+        return -1;
+    }
+    handoff_set_timeout(sock, HANDOFF_TIMEOUT_MS);
+
+    struct handoff_header header;
+    if (handoff_recv(sock, &header, sizeof(header)) < 0 ||
+        memcmp(header.magic, HANDOFF_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != HANDOFF_VERSION || header.shard_count < 1 || header.shard_count > CHAT_MAX_SHARDS) {
+        fprintf(stderr, "[ERROR] Server lama tidak mengirim data serah terima yang valid\n");
+        close(sock);
+        return -1;
+    }
+    if ((int)header.shard_count != config.num_shards) {
+        printf("[INFO] Memakai %u shard seperti server lama\n", header.shard_count);
+    }
+    config.num_shards = (int)header.shard_count;
+
+    // Tabel fd diperbesar sekali sekarang, selagi proses masih satu thread:
+    // jika tidak, kernel memperbesarnya berkali-kali saat fd klien diterima,
+    // dan pada proses multi-thread setiap pembesaran menunggu synchronize_rcu()
+    // (puluhan milidetik untuk 10 ribu sesi)
+    int top = fcntl(sock, F_DUPFD_CLOEXEC, (int)(header.session_count + header.shard_count) + 64);
+    if (top >= 0) {
+        close(top);
+    }
+
+    *listener_fds = malloc(config.num_shards * sizeof(int));
+    if (*listener_fds == NULL || handoff_recv_fds(sock, *listener_fds, config.num_shards) < 0) {
+        fprintf(stderr, "[ERROR] Gagal menerima listener dari server lama\n");
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+// Membuat ulang satu sesi dari snapshot server lama dengan socket fd.
+// -1 jika snapshot rusak.
+int restore_session(struct shard *shard, int fd, struct handoff_reader *reader) {
+    uint8_t name_len = handoff_get_u8(reader);
+    const char *name = handoff_get(reader, name_len);
+    uint8_t room_count = handoff_get_u8(reader);
+    const char *room_names[SESSION_MAX_ROOMS];
+    uint8_t room_lens[SESSION_MAX_ROOMS];
+    for (unsigned int r = 0; r < room_count; r++) {
+        uint8_t len = handoff_get_u8(reader);
+        const char *room_name = handoff_get(reader, len);
+        if (r < SESSION_MAX_ROOMS) {
+            room_names[r] = room_name;
+            room_lens[r] = len;
+        }
+    }
+    uint8_t active = handoff_get_u8(reader);
+    uint32_t pending_len = handoff_get_u32(reader);
+    const char *pending = handoff_get(reader, pending_len);
+    uint32_t frame_count = handoff_get_u32(reader);
+    uint32_t head_offset = handoff_get_u32(reader);
+    if (reader->failed || room_count > SESSION_MAX_ROOMS) {
+        close(fd);
+        return -1;
+    }
+
+    struct session *session = client_add(shard, fd);
+    if (session != NULL && name_len > 0 &&
+        session_set_username(&shard->sessions, session, name, name_len) < 0) {
+        perror("malloc");
+    }
+    for (unsigned int r = 0; session != NULL && r < room_count; r++) {
+        struct room *room;
+        if (room_join(&shard->rooms, session, room_names[r], room_lens[r], &room) < 0) {
+            perror("room_join");
+        }
+    }
+    if (session != NULL) {
+        session->active_room = active < room_count ? room_find(&shard->rooms, room_names[active], room_lens[active]) : NULL;
+    }
+
+    // Potongan frame yang belum utuh dilanjutkan oleh data berikutnya dari klien
+    while (session != NULL && pending_len > 0) {
+        size_t space;
+        char *dst = chat_parser_write_ptr(&session->parser, &space);
+        if (dst == NULL) {
+            perror("Gagal memperbesar buffer klien");
+            break;
+        }
+        size_t n = pending_len < space ? pending_len : space;
+        memcpy(dst, pending, n);
+        chat_parser_commit(&session->parser, n);
+        pending += n;
+        pending_len -= (uint32_t)n;
+    }
+
+    // Frame terdepan mungkin sudah terkirim sebagian: sisanya harus dikirim
+    // lebih dulu agar stream klien tetap utuh
+    int head_restored = 0;
+    for (uint32_t k = 0; k < frame_count; k++) {
+        uint32_t len = handoff_get_u32(reader);
+        const char *data = handoff_get(reader, len);
+        if (data == NULL || session == NULL || session->queue.count == session->queue.capacity) {
+            continue;
+        }
+        struct chat_buffer *frame = chat_buffer_alloc(len);
+        if (frame == NULL) {
+            perror("malloc");
+            continue;
+        }
+        memcpy(frame->data, data, len);
+        out_queue_push(&session->queue, frame);
+        chat_buffer_release(frame);
+        if (k == 0) {
+            head_restored = 1;
+        }
+    }
+    if (session != NULL && head_restored) {
+        session->queue.head_offset = head_offset;
+        session->queue.bytes -= head_offset;
+        session_schedule(shard, session);
+    } else if (session != NULL && frame_count > 0 && head_offset > 0) {
+        close_client(shard, fd);
+    }
+    return reader->failed ? -1 : 0;
+}
+
+// Menerima snapshot semua shard dari server lama dan membuat ulang sesinya.
+// Server lama berhenti total sejak koneksi serah terima dibuka sampai
+// takeover_confirm(). Mengembalikan jumlah sesi, -1 jika gagal.
+long takeover_restore(int sock) {
+    long restored = 0;
+    for (int i = 0; i < config.num_shards; i++) {
+        struct shard *shard = shards[i];
+        struct handoff_shard_header header;
+        if (handoff_recv(sock, &header, sizeof(header)) < 0) {
+            return -1;
+        }
+        char *data = malloc(header.data_len > 0 ? header.data_len : 1);
+        int *fds = malloc((header.session_count > 0 ? header.session_count : 1) * sizeof(int));
+        if (data == NULL || fds == NULL ||
+            handoff_recv(sock, data, header.data_len) < 0 ||
+            handoff_recv_fds(sock, fds, header.session_count) < 0) {
+            free(data);
+            free(fds);
+            return -1;
+        }
+
+        struct handoff_reader reader;
+        handoff_reader_init(&reader, data, header.data_len);
+        for (uint32_t j = 0; j < header.session_count; j++) {
+            if (restore_session(shard, fds[j], &reader) < 0) {
+                fprintf(stderr, "[ERROR] Snapshot shard %d rusak\n", i);
+                free(data);
+                free(fds);
+                return -1;
+            }
+        }
+        metric_set(&shard->metrics->sessions, shard->sessions.count);
+        restored += (long)shard->sessions.count;
+        free(data);
+        free(fds);
+    }
+    return restored;
+}
+
+// Konfirmasi ke server lama: setelah ini server lama berhenti dan sesinya milik
+// server ini. Sebelum konfirmasi, kegagalan apa pun membuat server lama
+// melanjutkan sesinya sendiri.
+int takeover_confirm(int sock) {
+    char ack = 'K';
+    return handoff_send(sock, &ack, 1);
+}
+
+void print_usage(const char *prog) {
+    printf("Penggunaan: %s [opsi]\n", prog);
+    printf("  --threads N           jumlah shard/worker thread (default: jumlah CPU)\n");
+    printf("  --pin                 kunci setiap worker ke satu CPU\n");
+    printf("  --max-message N       ukuran maksimum payload frame dalam byte (default: %d)\n", CHAT_DEFAULT_MAX_PAYLOAD);
+    printf("  --out-queue N         jumlah frame maksimum di antrian kirim per klien (default: 1024)\n");
+    printf("  --out-limit N         jumlah byte maksimum di antrian kirim per klien (default: 4194304)\n");
+    printf("  --slow-policy MODE    drop | coalesce | disconnect (default: drop)\n");
+    printf("  --log-interval MS     interval group commit log (default: 10)\n");
+    printf("  --log-fsync MODE      none | batch | second (default: none)\n");
+    printf("  --log-queue N         kapasitas antrian log (default: 16384)\n");
+    printf("  --metrics-socket PATH socket Unix untuk metrik format Prometheus, 'none' = mati (default: %s)\n", METRICS_SOCKET);
+    printf("  --journal-dir DIR     direktori journal pesan, 'none' = mati (default: %s)\n", JOURNAL_DIR);
+    printf("  --journal-segment-mb N ukuran satu segmen journal dalam MiB (default: 64)\n");
+    printf("  --journal-segments N  jumlah segmen journal yang disimpan (default: 16)\n");
+    printf("  --history N           jumlah pesan riwayat saat masuk room, maks %d (default: 20)\n", JOURNAL_HISTORY_MAX);
+    printf("  --metrics-interval S  detik antar baris ringkasan metrik, 0 = mati (default: 10)\n");
+    printf("  --backend MODE        epoll | uring (default: epoll; uring jatuh ke epoll jika kernel tidak mendukung)\n");
+    printf("  --zerocopy-min N      kiriman io_uring mulai N byte memakai zero-copy, 0 = mati (default: 16384)\n");
+    printf("  --backlog N           panjang antrian listen() (default: 4096, dibatasi net.core.somaxconn)\n");
+    printf("  --defer-accept S      TCP_DEFER_ACCEPT dalam detik, 0 = mati (default: 5)\n");
+    printf("  --accept-batch N      koneksi maksimum per event listener (default: 64)\n");
+    printf("  --max-sessions N      batas sesi di semua shard, 0 = tanpa batas (default: 0)\n");
+    printf("  --accept-rate N       batas koneksi baru per detik, 0 = tanpa batas (default: 0)\n");
+    printf("  --msg-rate N          batas frame per detik per klien, 0 = tanpa batas (default: 100)\n");
+    printf("  --byte-rate N         batas byte per detik per klien, 0 = tanpa batas (default: 262144)\n");
+    printf("  --dup-window S        buang pesan yang sama dari klien dalam S detik, 0 = mati (default: 2)\n");
+    printf("  --ping-interval S     kirim PING ke klien yang diam selama S detik, 0 = mati (default: 30)\n");
+    printf("  --idle-timeout S      putus klien tanpa data/PONG selama S detik, 0 = mati (default: 90)\n");
+    printf("  --login-timeout S     putus koneksi yang belum LOGIN setelah S detik, 0 = mati (default: 10)\n");
+    printf("  --write-stall S       putus klien yang antrian kirimnya macet S detik, 0 = mati (default: 30)\n");
+    printf("  --handoff-socket PATH socket Unix serah terima untuk hot restart, 'none' = mati (default: %s)\n", HANDOFF_SOCKET);
+    printf("  --takeover            ambil alih listener dan sesi dari server yang berjalan di --handoff-socket\n");
+}
+
+int main(int argc, char *argv[]) {
+    static const struct option long_options[] = {
+        {"threads", required_argument, NULL, 't'},
+        {"pin", no_argument, NULL, 'p'},
+        {"max-message", required_argument, NULL, 'm'},
+        {"out-queue", required_argument, NULL, 'o'},
+        {"out-limit", required_argument, NULL, 'b'},
+        {"slow-policy", required_argument, NULL, 's'},
+        {"log-interval", required_argument, NULL, 'i'},
+        {"log-fsync", required_argument, NULL, 'f'},
+        {"log-queue", required_argument, NULL, 'q'},
+        {"metrics-socket", required_argument, NULL, 'M'},
+        {"metrics-interval", required_argument, NULL, 'I'},
+        {"journal-dir", required_argument, NULL, 'j'},
+        {"journal-segment-mb", required_argument, NULL, 'J'},
+        {"journal-segments", required_argument, NULL, 'k'},
+        {"history", required_argument, NULL, 'H'},
+        {"backend", required_argument, NULL, 'B'},
+        {"zerocopy-min", required_argument, NULL, 'z'},
+        {"backlog", required_argument, NULL, 'l'},
+        {"defer-accept", required_argument, NULL, 'd'},
+        {"accept-batch", required_argument, NULL, 'a'},
+        {"max-sessions", required_argument, NULL, 'S'},
+        {"accept-rate", required_argument, NULL, 'r'},
+        {"msg-rate", required_argument, NULL, 'u'},
+        {"byte-rate", required_argument, NULL, 'y'},
+        {"dup-window", required_argument, NULL, 'D'},
+        {"ping-interval", required_argument, NULL, 'P'},
+        {"idle-timeout", required_argument, NULL, 'T'},
+        {"login-timeout", required_argument, NULL, 'L'},
+        {"write-stall", required_argument, NULL, 'W'},
+        {"handoff-socket", required_argument, NULL, 'O'},
+        {"takeover", no_argument, NULL, 'R'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    config.num_shards = ncpu > 0 ? (int)(ncpu < CHAT_MAX_SHARDS ? ncpu : CHAT_MAX_SHARDS) : 1;
+    config.pin_cpus = 0;
+    config.max_message = CHAT_DEFAULT_MAX_PAYLOAD;
+    config.out_queue_len = 1024;
+    config.out_queue_bytes = 4 * 1024 * 1024;
+    config.slow_policy = SLOW_DROP_OLDEST;
+    config.log.path = LOG_FILE;
+    config.log.interval_ms = 10;
+    config.log.fsync_policy = LOG_FSYNC_NONE;
+    config.log.queue_size = 16384;
+    config.metrics.socket_path = METRICS_SOCKET;
+    config.metrics.summary_interval = 10;
+    config.journal.dir = JOURNAL_DIR;
+    config.journal.segment_size = 64 * 1024 * 1024;
+    config.journal.max_segments = 16;
+    config.history = 20;
+    config.backend = BACKEND_EPOLL;
+    config.zerocopy_min = 16384;
+    config.backlog = 4096;
+    config.defer_accept = 5;
+    config.accept_batch = 64;
+    config.max_sessions = 0;
+    config.accept_rate = 0;
+    config.msg_rate = 100;
+    config.byte_rate = 256 * 1024;
+    config.dup_window = 2;
+    config.ping_interval = 30;
+    config.idle_timeout = 90;
+    config.login_timeout = 10;
+    config.write_stall = 30;
+    config.handoff_path = HANDOFF_SOCKET;
+    config.takeover = 0;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "t:pm:o:b:s:i:f:q:M:I:j:J:k:H:B:z:l:d:a:S:r:u:y:D:P:T:L:W:O:Rh", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 't':
+            config.num_shards = atoi(optarg);
+            if (config.num_shards < 1 || config.num_shards > CHAT_MAX_SHARDS) {
+                fprintf(stderr, "Jumlah thread harus antara 1 dan %d\n", CHAT_MAX_SHARDS);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'p':
+            config.pin_cpus = 1;
+            break;
+        case 'm':
+            config.max_message = strtoul(optarg, NULL, 10);
+            if (config.max_message < 1 || config.max_message > UINT32_MAX) {
+                fprintf(stderr, "Ukuran pesan maksimum tidak valid\n");
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'o':
+            config.out_queue_len = (unsigned int)strtoul(optarg, NULL, 10);
+            break;
+        case 'b':
+            config.out_queue_bytes = strtoul(optarg, NULL, 10);
+            break;
+        case 's':
+            if (strcmp(optarg, "drop") == 0) {
+                config.slow_policy = SLOW_DROP_OLDEST;
+            } else if (strcmp(optarg, "coalesce") == 0) {
+                config.slow_policy = SLOW_COALESCE;
+            } else if (strcmp(optarg, "disconnect") == 0) {
+                config.slow_policy = SLOW_DISCONNECT;
+            } else {
+                fprintf(stderr, "Kebijakan slow consumer tidak dikenal: %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'i':
+            config.log.interval_ms = atoi(optarg);
+            break;
+        case 'f':
+            if (strcmp(optarg, "none") == 0) {
+                config.log.fsync_policy = LOG_FSYNC_NONE;
+            } else if (strcmp(optarg, "batch") == 0) {
+                config.log.fsync_policy = LOG_FSYNC_BATCH;
+            } else if (strcmp(optarg, "second") == 0) {
+                config.log.fsync_policy = LOG_FSYNC_SECOND;
+            } else {
+                fprintf(stderr, "Mode fsync tidak dikenal: %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'q':
+            config.log.queue_size = strtoul(optarg, NULL, 10);
+            break;
+        case 'M':
+            config.metrics.socket_path = strcmp(optarg, "none") == 0 ? NULL : optarg;
+            break;
+        case 'I':
+            config.metrics.summary_interval = atoi(optarg);
+            break;
+        case 'j':
+            config.journal.dir = strcmp(optarg, "none") == 0 ? NULL : optarg;
+            break;
+        case 'J':
+            config.journal.segment_size = strtoul(optarg, NULL, 10) * 1024 * 1024;
+            break;
+        case 'k':
+            config.journal.max_segments = (unsigned int)strtoul(optarg, NULL, 10);
+            break;
+        case 'H':
+            config.history = (unsigned int)strtoul(optarg, NULL, 10);
+            if (config.history > JOURNAL_HISTORY_MAX) {
+                config.history = JOURNAL_HISTORY_MAX;
+            }
+            break;
+        case 'B':
+            if (strcmp(optarg, "epoll") == 0) {
+                config.backend = BACKEND_EPOLL;
+            } else if (strcmp(optarg, "uring") == 0) {
+                config.backend = BACKEND_URING;
+            } else {
+                fprintf(stderr, "Backend tidak dikenal: %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'z':
+            config.zerocopy_min = strtoul(optarg, NULL, 10);
+            break;
+        case 'l':
+            config.backlog = atoi(optarg);
+            if (config.backlog < 1) {
+                fprintf(stderr, "Backlog harus minimal 1\n");
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'd':
+            config.defer_accept = atoi(optarg);
+            break;
+        case 'a':
+            config.accept_batch = (unsigned int)strtoul(optarg, NULL, 10);
+            if (config.accept_batch < 1) {
+                config.accept_batch = 1;
+            }
+            break;
+        case 'S':
+            config.max_sessions = strtol(optarg, NULL, 10);
+            break;
+        case 'r':
+            config.accept_rate = atof(optarg);
+            break;
+        case 'u':
+            config.msg_rate = atof(optarg);
+            break;
+        case 'y':
+            config.byte_rate = atof(optarg);
+            break;
+        case 'D':
+            config.dup_window = (unsigned int)strtoul(optarg, NULL, 10);
+            break;
+        case 'P':
+            config.ping_interval = (unsigned int)strtoul(optarg, NULL, 10);
+            break;
+        case 'T':
+            config.idle_timeout = (unsigned int)strtoul(optarg, NULL, 10);
+            break;
+        case 'L':
+            config.login_timeout = (unsigned int)strtoul(optarg, NULL, 10);
+            break;
+        case 'W':
+            config.write_stall = (unsigned int)strtoul(optarg, NULL, 10);
+            break;
+        case 'O':
+            config.handoff_path = strcmp(optarg, "none") == 0 ? NULL : optarg;
+            break;
+        case 'R':
+            config.takeover = 1;
+            break;
+        default:
+            print_usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    // Penulisan ke klien yang sudah putus cukup menghasilkan EPIPE
+    signal(SIGPIPE, SIG_IGN);
+
+    // SIGINT/SIGTERM hanya ditangani thread utama (lewat signalfd) agar log
+    // yang masih di antrian sempat ditulis sebelum server berhenti.
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, NULL);
+
+    check_backlog();
+    if (config.ping_interval > 0 && config.idle_timeout > 0 && config.idle_timeout <= config.ping_interval) {
+        fprintf(stderr, "[WARN] --idle-timeout %u tidak lebih lama dari --ping-interval %u: klien diputus sebelum sempat membalas PING\n",
+                config.idle_timeout, config.ping_interval);
+    }
+
+    if (config.backend == BACKEND_URING) {
+        const char *reason;
+        if (chat_uring_probe(&reason) < 0) {
+            fprintf(stderr, "[WARN] Backend io_uring tidak tersedia (%s), memakai epoll\n", reason);
+            config.backend = BACKEND_EPOLL;
+        }
+    }
+
+    // Server lama berhenti melayani sejak koneksi ini dibuka, jadi log baru
+    // dibuka setelahnya. Journal server lama baru ditulis habis dan ditahan
+    // setelah semua shard-nya berhenti, jadi journal dibuka setelah snapshot
+    // diterima (lihat di bawah) agar tidak ada dua penulis pada segmen yang sama.
+    int takeover_fd = -1;
+    int *listener_fds = NULL;
+    uint64_t takeover_started = metrics_now();
+    if (config.takeover) {
+        if (config.handoff_path == NULL) {
+            fprintf(stderr, "--takeover membutuhkan --handoff-socket\n");
+            return EXIT_FAILURE;
+        }
+        takeover_fd = takeover_connect(&listener_fds);
+        if (takeover_fd < 0) {
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (log_start(&config.log) < 0 || (takeover_fd < 0 && journal_open(&config.journal) < 0)) {
+        exit(EXIT_FAILURE);
+    }
+
+    shards = calloc(config.num_shards, sizeof(*shards));
+    if (shards == NULL || metrics_init(config.num_shards) < 0) {
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < config.num_shards; i++) {
+        shards[i] = shard_create(i, listener_fds != NULL ? listener_fds[i] : -1);
+        if (shards[i] == NULL) {
+            exit(EXIT_FAILURE);
+        }
+    }
+    free(listener_fds);
+
+    if (takeover_fd >= 0) {
+        long restored = takeover_restore(takeover_fd);
+        if (restored < 0 || journal_open(&config.journal) < 0 || takeover_confirm(takeover_fd) < 0) {
+            fprintf(stderr, "[ERROR] Serah terima gagal, server lama tetap berjalan\n");
+            exit(EXIT_FAILURE);
+        }
+        close(takeover_fd);
+        printf("[INFO] %ld sesi diambil alih dari server lama dalam %.2f ms\n", restored,
+               (double)(metrics_now() - takeover_started) / 1e6);
+    }
+
+    if (metrics_start(&config.metrics) < 0) {
+        exit(EXIT_FAILURE);
+    }
+    if (pthread_barrier_init(&handoff_barrier, NULL, config.num_shards + 1) != 0) {
+        perror("pthread_barrier_init");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("Listening on port %d with %d shard(s), backend %s\n", PORT, config.num_shards,
+           config.backend == BACKEND_URING ? "io_uring" : "epoll");
+
+    for (int i = 0; i < config.num_shards; i++) {
+        if (pthread_create(&shards[i]->thread, NULL, shard_run, shards[i]) != 0) {
+            perror("pthread_create");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Thread utama menunggu sinyal berhenti atau server baru yang meminta
+    // serah terima
+    int signal_fd = signalfd(-1, &stop_signals, SFD_CLOEXEC);
+    if (signal_fd < 0) {
+        perror("signalfd");
+        exit(EXIT_FAILURE);
+    }
+    int handoff_fd = config.handoff_path != NULL ? handoff_listen(config.handoff_path) : -1;
+    struct pollfd fds[2] = {{signal_fd, POLLIN, 0}, {handoff_fd, POLLIN, 0}};
+    while (1) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("poll");
+            break;
+        }
+        if (fds[0].revents & POLLIN) {
+            struct signalfd_siginfo info;
+            if (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+                printf("Server berhenti (sinyal %u)\n", info.ssi_signo);
+            }
+            break;
+        }
+        if (fds[1].revents & POLLIN) {
+            int sock = accept4(handoff_fd, NULL, NULL, SOCK_CLOEXEC);
+            if (sock < 0) {
+                perror("accept serah terima");
+                continue;
+            }
+            int rc = serve_handoff(sock);
+            close(sock);
+            if (rc == 0) {
+                // Path socket serah terima sekarang milik server baru
+                journal_close();
+                log_stop();
+                return 0;
+            }
+        }
+    }
+    if (handoff_fd >= 0) {
+        close(handoff_fd);
+        unlink(config.handoff_path);
+    }
+    metrics_stop();
+    journal_close();
+    log_stop();
     return 0;
 }
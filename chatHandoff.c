@@ -0,0 +1,245 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "chatHandoff.h"
+
+#define HANDOFF_INITIAL_CAPACITY (64 * 1024)
+
+void handoff_buffer_init(struct handoff_buffer *buf) {
+    buf->data = NULL;
+    buf->len = 0;
+    buf->capacity = 0;
+    buf->failed = 0;
+}
+
+void handoff_buffer_free(struct handoff_buffer *buf) {
+    free(buf->data);
+    handoff_buffer_init(buf);
+}
+
+void handoff_put(struct handoff_buffer *buf, const void *data, size_t len) {
+    if (buf->failed) {
+        return;
+    }
+    if (buf->len + len > buf->capacity) {
+        size_t capacity = buf->capacity > 0 ? buf->capacity : HANDOFF_INITIAL_CAPACITY;
+        while (capacity < buf->len + len) {
+            capacity *= 2;
+        }
+        char *grown = realloc(buf->data, capacity);
+        if (grown == NULL) {
+            buf->failed = 1;
+            return;
+        }
+        buf->data = grown;
+        buf->capacity = capacity;
+    }
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+}
+
+void handoff_put_u8(struct handoff_buffer *buf, uint8_t value) {
+    handoff_put(buf, &value, sizeof(value));
+}
+
+void handoff_put_u32(struct handoff_buffer *buf, uint32_t value) {
+    handoff_put(buf, &value, sizeof(value));
+}
+
+void handoff_reader_init(struct handoff_reader *reader, const void *data, size_t len) {
+    reader->data = data;
+    reader->len = len;
+    reader->pos = 0;
+    reader->failed = 0;
+}
+
+const char *handoff_get(struct handoff_reader *reader, size_t len) {
+    if (reader->failed || reader->len - reader->pos < len) {
+        reader->failed = 1;
+        return NULL;
+    }
+    const char *p = reader->data + reader->pos;
+    reader->pos += len;
+    return p;
+}
+
+uint8_t handoff_get_u8(struct handoff_reader *reader) {
+    const char *p = handoff_get(reader, 1);
+    return p != NULL ? (uint8_t)p[0] : 0;
+}
+
+uint32_t handoff_get_u32(struct handoff_reader *reader) {
+    uint32_t value = 0;
+    const char *p = handoff_get(reader, sizeof(value));
+    if (p != NULL) {
+        memcpy(&value, p, sizeof(value));
+    }
+    return value;
+}
+
+static int handoff_address(const char *path, struct sockaddr_un *addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) {
+        fprintf(stderr, "[ERROR] Path socket serah terima terlalu panjang: %s\n", path);
+        return -1;
+    }
+    strcpy(addr->sun_path, path);
+    return 0;
+}
+
+int handoff_listen(const char *path) {
+    struct sockaddr_un addr;
+    if (handoff_address(path, &addr) < 0) {
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("socket serah terima");
+        return -1;
+    }
+    // Socket sisa server sebelumnya dihapus dulu
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || chmod(path, 0600) < 0 || listen(fd, 1) < 0) {
+        perror("[ERROR] Gagal membuka socket serah terima");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int handoff_connect(const char *path) {
+    struct sockaddr_un addr;
+    if (handoff_address(path, &addr) < 0) {
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("socket serah terima");
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("[ERROR] Gagal terhubung ke server lama");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int handoff_set_timeout(int sock, int timeout_ms) {
+    struct timeval timeout;
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_usec = (timeout_ms % 1000) * 1000;
+    if (setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0 ||
+        setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) < 0) {
+        perror("setsockopt serah terima");
+        return -1;
+    }
+    return 0;
+}
+
+int handoff_send(int sock, const void *data, size_t len) {
+    const char *p = data;
+    while (len > 0) {
+        ssize_t n = send(sock, p, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+int handoff_recv(int sock, void *data, size_t len) {
+    char *p = data;
+    while (len > 0) {
+        ssize_t n = recv(sock, p, len, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// Setiap potongan fd menumpang pada satu byte data
+int handoff_send_fds(int sock, const int *fds, size_t count) {
+    char control[CMSG_SPACE(HANDOFF_FDS_PER_MSG * sizeof(int))];
+    while (count > 0) {
+        size_t n = count < HANDOFF_FDS_PER_MSG ? count : HANDOFF_FDS_PER_MSG;
+        char marker = 'F';
+        struct iovec iov = {&marker, 1};
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = CMSG_SPACE(n * sizeof(int));
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(n * sizeof(int));
+        memcpy(CMSG_DATA(cmsg), fds, n * sizeof(int));
+
+        ssize_t sent;
+        do {
+            sent = sendmsg(sock, &msg, MSG_NOSIGNAL);
+        } while (sent < 0 && errno == EINTR);
+        if (sent != 1) {
+            return -1;
+        }
+        fds += n;
+        count -= n;
+    }
+    return 0;
+}
+
+int handoff_recv_fds(int sock, int *fds, size_t count) {
+    char control[CMSG_SPACE(HANDOFF_FDS_PER_MSG * sizeof(int))];
+    size_t received = 0;
+    while (received < count) {
+        char marker;
+        struct iovec iov = {&marker, 1};
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        ssize_t n;
+        do {
+            n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+        } while (n < 0 && errno == EINTR);
+        if (n != 1 || (msg.msg_flags & MSG_CTRUNC)) {
+            return -1;
+        }
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        if (cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+            return -1;
+        }
+        size_t got = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        if (got > count - received) {
+            return -1;
+        }
+        memcpy(fds + received, CMSG_DATA(cmsg), got * sizeof(int));
+        received += got;
+    }
+    return 0;
+}
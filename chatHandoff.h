@@ -0,0 +1,86 @@
+#ifndef CHAT_HANDOFF_H
+#define CHAT_HANDOFF_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Serah terima server lama ke server baru (hot restart) lewat socket Unix.
+// Server baru (--takeover) terhubung ke socket serah terima server lama, lalu
+// server lama mengirim:
+//
+//   handoff_header                 + fd listener (satu per shard)
+//   untuk setiap shard:
+//     handoff_shard_header
+//     snapshot sesi (data_len byte) + fd klien (satu per sesi, urut snapshot)
+//
+// dan menunggu satu byte konfirmasi sebelum berhenti. fd dikirim dengan
+// SCM_RIGHTS dalam potongan HANDOFF_FDS_PER_MSG, terpisah dari data, sehingga
+// byte pembawa fd tidak pernah terbaca oleh read data biasa.
+
+#define HANDOFF_MAGIC "CHATHOF1"
+#define HANDOFF_VERSION 1
+#define HANDOFF_FDS_PER_MSG 250  // batas kernel SCM_MAX_FD = 253
+
+struct handoff_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t shard_count;
+    uint32_t session_count;  // semua shard, untuk menyiapkan tabel fd penerima
+    uint32_t reserved;
+};
+
+struct handoff_shard_header {
+    uint32_t session_count;
+    uint32_t reserved;
+    uint64_t data_len;
+};
+
+// Buffer snapshot yang tumbuh otomatis. Kegagalan alokasi cukup diperiksa
+// sekali lewat failed setelah semua data ditulis.
+struct handoff_buffer {
+    char *data;
+    size_t len;
+    size_t capacity;
+    int failed;
+};
+
+// Pembaca snapshot; failed diisi jika data habis sebelum waktunya
+struct handoff_reader {
+    const char *data;
+    size_t len;
+    size_t pos;
+    int failed;
+};
+
+void handoff_buffer_init(struct handoff_buffer *buf);
+void handoff_buffer_free(struct handoff_buffer *buf);
+void handoff_put(struct handoff_buffer *buf, const void *data, size_t len);
+void handoff_put_u8(struct handoff_buffer *buf, uint8_t value);
+void handoff_put_u32(struct handoff_buffer *buf, uint32_t value);
+
+void handoff_reader_init(struct handoff_reader *reader, const void *data, size_t len);
+// Pointer ke len byte berikutnya tanpa salinan, NULL jika data tidak cukup
+const char *handoff_get(struct handoff_reader *reader, size_t len);
+uint8_t handoff_get_u8(struct handoff_reader *reader);
+uint32_t handoff_get_u32(struct handoff_reader *reader);
+
+// Socket Unix serah terima. handoff_listen() menghapus socket sisa lebih dulu
+// dan hanya bisa dibuka pemilik proses, karena siapa pun yang terhubung
+// menerima semua socket klien.
+int handoff_listen(const char *path);
+int handoff_connect(const char *path);
+
+// Batas waktu send/recv di socket serah terima agar server yang macet di sisi
+// lain tidak menahan proses ini selamanya
+int handoff_set_timeout(int sock, int timeout_ms);
+
+// Mengirim/menerima tepat len byte. 0 jika berhasil, -1 jika gagal atau
+// koneksi tertutup.
+int handoff_send(int sock, const void *data, size_t len);
+int handoff_recv(int sock, void *data, size_t len);
+
+// Mengirim/menerima tepat count fd. fd yang diterima sudah FD_CLOEXEC.
+int handoff_send_fds(int sock, const int *fds, size_t count);
+int handoff_recv_fds(int sock, int *fds, size_t count);
+
+#endif
@@ -0,0 +1,93 @@
+#include <string.h>
+
+#include "chatHistogram.h"
+
+// Posisi bit tertinggi yang bernilai 1 (value > 0)
+static unsigned int highest_bit(uint64_t value) {
+    return 63u - (unsigned int)__builtin_clzll(value);
+}
+
+static size_t bucket_index(uint64_t value) {
+    if (value < 2 * CHAT_HISTOGRAM_SUB_COUNT) {
+        return (size_t)value;
+    }
+    // Simpan 7 bit teratas: bit tertinggi menentukan kelompok, 6 bit berikutnya sub-bucket
+    unsigned int shift = highest_bit(value) - CHAT_HISTOGRAM_SUB_BITS;
+    return (size_t)(shift + 1) * CHAT_HISTOGRAM_SUB_COUNT + (size_t)((value >> shift) - CHAT_HISTOGRAM_SUB_COUNT);
+}
+
+uint64_t chat_histogram_bucket_limit(size_t index) {
+    if (index < 2 * CHAT_HISTOGRAM_SUB_COUNT) {
+        return index;
+    }
+    unsigned int shift = (unsigned int)(index / CHAT_HISTOGRAM_SUB_COUNT) - 1;
+    uint64_t base = (uint64_t)(index % CHAT_HISTOGRAM_SUB_COUNT + CHAT_HISTOGRAM_SUB_COUNT) << shift;
+    return base + (((uint64_t)1 << shift) - 1);
+}
+
+void chat_histogram_reset(struct chat_histogram *hist) {
+    memset(hist, 0, sizeof(*hist));
+    hist->min = UINT64_MAX;
+}
+
+void chat_histogram_record(struct chat_histogram *hist, uint64_t value) {
+    hist->buckets[bucket_index(value)]++;
+    hist->count++;
+    hist->sum += value;
+    if (value < hist->min) {
+        hist->min = value;
+    }
+    if (value > hist->max) {
+        hist->max = value;
+    }
+}
+
+void chat_histogram_merge(struct chat_histogram *dst, const struct chat_histogram *src) {
+    if (src->count == 0) {
+        return;
+    }
+    for (size_t i = 0; i < CHAT_HISTOGRAM_BUCKETS; i++) {
+        dst->buckets[i] += src->buckets[i];
+    }
+    dst->count += src->count;
+    dst->sum += src->sum;
+    if (src->min < dst->min) {
+        dst->min = src->min;
+    }
+    if (src->max > dst->max) {
+        dst->max = src->max;
+    }
+}
+
+uint64_t chat_histogram_percentile(const struct chat_histogram *hist, double percentile) {
+    if (hist->count == 0) {
+        return 0;
+    }
+    if (percentile > 100.0) {
+        percentile = 100.0;
+    }
+    uint64_t rank = (uint64_t)(percentile / 100.0 * (double)hist->count + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < CHAT_HISTOGRAM_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen >= rank) {
+            // Batas atas bucket tidak pernah melewati nilai maksimum yang tercatat
+            uint64_t limit = chat_histogram_bucket_limit(i);
+            return limit < hist->max ? limit : hist->max;
+        }
+    }
+    return hist->max;
+}
+
+uint64_t chat_histogram_count_below(const struct chat_histogram *hist, uint64_t value) {
+    uint64_t total = 0;
+    size_t last = bucket_index(value);
+    for (size_t i = 0; i <= last; i++) {
+        total += hist->buckets[i];
+    }
+    return total;
+}
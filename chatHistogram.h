@@ -0,0 +1,39 @@
+#ifndef CHAT_HISTOGRAM_H
+#define CHAT_HISTOGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Histogram bergaya HDR: 128 bucket linear untuk nilai kecil, lalu setiap
+// pangkat dua dibagi lagi menjadi 64 sub-bucket. Galat relatif maksimum
+// sekitar 1,6% untuk semua nilai 64-bit, tanpa alokasi dan tanpa batas atas.
+#define CHAT_HISTOGRAM_SUB_BITS 6
+#define CHAT_HISTOGRAM_SUB_COUNT (1u << CHAT_HISTOGRAM_SUB_BITS)
+#define CHAT_HISTOGRAM_BUCKETS ((64 - CHAT_HISTOGRAM_SUB_BITS + 1) * CHAT_HISTOGRAM_SUB_COUNT)
+
+struct chat_histogram {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+    uint64_t buckets[CHAT_HISTOGRAM_BUCKETS];
+};
+
+void chat_histogram_reset(struct chat_histogram *hist);
+void chat_histogram_record(struct chat_histogram *hist, uint64_t value);
+
+// Menjumlahkan isi src ke dst (misalnya histogram per thread ke total)
+void chat_histogram_merge(struct chat_histogram *dst, const struct chat_histogram *src);
+
+// Nilai pada persentil tertentu (0-100), dibulatkan ke batas atas bucket-nya.
+// Mengembalikan 0 jika histogram kosong.
+uint64_t chat_histogram_percentile(const struct chat_histogram *hist, double percentile);
+
+// Jumlah sampel yang nilainya <= value (untuk bucket kumulatif Prometheus).
+// Dihitung per bucket, jadi nilai di dekat batas bisa meleset satu bucket.
+uint64_t chat_histogram_count_below(const struct chat_histogram *hist, uint64_t value);
+
+// Batas atas nilai yang masuk ke bucket index (dipakai untuk ekspor bucket)
+uint64_t chat_histogram_bucket_limit(size_t index);
+
+#endif
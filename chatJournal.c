@@ -0,0 +1,741 @@
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "chatJournal.h"
+#include "chatRing.h"
+#include "chatSession.h"
+
+#define JOURNAL_QUEUE_SIZE 16384
+
+// Satu file segmen yang di-mmap. refcount: satu milik journal ditambah satu
+// per buffer riwayat yang masih ada di antrian klien.
+struct journal_segment {
+    uint32_t id;
+    char *base;
+    size_t size;
+    atomic_int refcount;
+    struct journal_segment_header *header;
+};
+
+// Tail room di memori: posisi record terakhir setiap room. position ditulis
+// thread journal setelah committed segmennya, jadi pembaca yang melihat
+// posisi baru pasti juga melihat record-nya.
+struct room_tail_slot {
+    uint32_t hash;
+    unsigned char len;
+    char name[CHAT_ROOM_MAX];
+    _Atomic uint64_t position;
+};
+
+// Pesan room yang menunggu ditulis thread journal. Frame ditahan satu
+// referensi sampai disalin ke segmen.
+struct journal_entry {
+    struct chat_buffer *frame;
+    int64_t timestamp_us;
+    unsigned char room_len;
+    char room[CHAT_ROOM_MAX];
+};
+
+// Hanya thread journal yang menulis ke segmen dan tail room. Lock ini diambil
+// eksklusif sebentar saat daftar segmen atau tabel tail berubah (room baru,
+// pergantian segmen, retensi), dan bersama oleh replay yang mengikuti rantai
+// record. Shard tidak pernah menunggu lock ini saat mengirim pesan.
+static pthread_rwlock_t journal_lock = PTHREAD_RWLOCK_INITIALIZER;
+static struct journal_config journal_cfg;
+static int journal_opened;
+
+// Segmen yang masih ada, urut dari id terkecil; segmen terakhir yang aktif
+static struct journal_segment **segments;
+static size_t segment_count;
+static size_t segment_capacity;
+
+static struct room_tail_slot *tails;
+static size_t tail_capacity;
+static size_t tail_count;
+
+// Antrian shard -> thread journal, dibangunkan lewat eventfd seperti inbox shard
+static struct chat_ring journal_queue;
+static pthread_t journal_thread;
+static atomic_int journal_running;
+static atomic_ulong journal_dropped;
+static int journal_wake_fd = -1;
+static atomic_int journal_wake_pending;
+
+// Segmen berikutnya yang sudah dibuat dan di-mmap lebih dulu oleh thread
+// journal, agar pergantian segmen tidak menunggu ftruncate dan mmap
+static struct journal_segment *spare;
+static int spare_wanted;
+
+int journal_segment_valid(const struct journal_segment_header *header, size_t file_size) {
+    return file_size >= JOURNAL_HEADER_SIZE && memcmp(header->magic, JOURNAL_MAGIC, 8) == 0 &&
+           header->version == JOURNAL_VERSION && header->size == file_size;
+}
+
+const struct journal_record *journal_record_at(const char *base, uint64_t committed, uint64_t offset) {
+    if (offset < JOURNAL_HEADER_SIZE || (offset & 7) != 0 || offset + sizeof(struct journal_record) > committed) {
+        return NULL;
+    }
+    const struct journal_record *record = (const struct journal_record *)(base + offset);
+    if (record->length < CHAT_FRAME_HEADER_SIZE || offset + JOURNAL_RECORD_SIZE(record->length) > committed) {
+        return NULL;
+    }
+    return record;
+}
+
+int journal_record_fields(const struct journal_record *record, const char **sender, size_t *sender_len,
+                          const char **room, size_t *room_len, const char **text, size_t *text_len) {
+    // Payload frame CHAT: u8 panjang pengirim | pengirim | u8 panjang room | room | teks
+    const char *payload = record->frame + CHAT_FRAME_HEADER_SIZE;
+    size_t length = record->length - CHAT_FRAME_HEADER_SIZE;
+    size_t offset = 0;
+    int n = chat_read_field(payload, length, &offset, sender);
+    if (n < 0) {
+        return -1;
+    }
+    *sender_len = (size_t)n;
+    n = chat_read_field(payload, length, &offset, room);
+    if (n < 0) {
+        return -1;
+    }
+    *room_len = (size_t)n;
+    *text = payload + offset;
+    *text_len = length - offset;
+    return 0;
+}
+
+static struct room_tail_slot *tail_lookup(const char *name, size_t len, int create) {
+    if (tail_capacity == 0 || (create && (tail_count + 1) * 2 > tail_capacity)) {
+        if (!create) {
+            return NULL;
+        }
+        // Tumbuh dua kali lipat, lalu masukkan ulang semua entri
+        size_t capacity = tail_capacity > 0 ? tail_capacity * 2 : 64;
+        struct room_tail_slot *grown = calloc(capacity, sizeof(*grown));
+        if (grown == NULL) {
+            return NULL;
+        }
+        for (size_t i = 0; i < tail_capacity; i++) {
+            if (tails[i].len == 0) {
+                continue;
+            }
+            size_t j = tails[i].hash & (capacity - 1);
+            while (grown[j].len != 0) {
+                j = (j + 1) & (capacity - 1);
+            }
+            grown[j].hash = tails[i].hash;
+            grown[j].len = tails[i].len;
+            memcpy(grown[j].name, tails[i].name, tails[i].len);
+            atomic_init(&grown[j].position, atomic_load_explicit(&tails[i].position, memory_order_relaxed));
+        }
+        free(tails);
+        tails = grown;
+        tail_capacity = capacity;
+    }
+
+    uint32_t hash = chat_hash_name(name, len);
+    size_t i = hash & (tail_capacity - 1);
+    while (tails[i].len != 0) {
+        if (tails[i].hash == hash && tails[i].len == len && memcmp(tails[i].name, name, len) == 0) {
+            return &tails[i];
+        }
+        i = (i + 1) & (tail_capacity - 1);
+    }
+    if (!create) {
+        return NULL;
+    }
+    tails[i].hash = hash;
+    tails[i].len = (unsigned char)len;
+    memcpy(tails[i].name, name, len);
+    atomic_init(&tails[i].position, 0);
+    tail_count++;
+    return &tails[i];
+}
+
+static struct journal_segment *find_segment(uint32_t id) {
+    if (segment_count == 0 || id < segments[0]->id) {
+        return NULL;
+    }
+    // Id segmen berurutan, kecuali ada file yang hilang atau rusak
+    size_t i = id - segments[0]->id;
+    if (i < segment_count && segments[i]->id == id) {
+        return segments[i];
+    }
+    for (i = 0; i < segment_count; i++) {
+        if (segments[i]->id == id) {
+            return segments[i];
+        }
+    }
+    return NULL;
+}
+
+static void segment_release(void *owner) {
+    struct journal_segment *segment = owner;
+    if (atomic_fetch_sub_explicit(&segment->refcount, 1, memory_order_acq_rel) == 1) {
+        munmap(segment->base, segment->size);
+        free(segment);
+    }
+}
+
+static void segment_path(char *out, size_t cap, uint32_t id) {
+    snprintf(out, cap, "%s/%08u.jnl", journal_cfg.dir, id);
+}
+
+// Nama file segmen yang sudah disiapkan tapi belum dipakai. Tidak cocok dengan
+// pola *.jnl, jadi diabaikan saat start dan oleh alat ekspor.
+static void spare_path(char *out, size_t cap, uint32_t id) {
+    snprintf(out, cap, "%s/%08u.jnl.tmp", journal_cfg.dir, id);
+}
+
+static struct journal_segment *map_segment(uint32_t id, int fd, size_t size) {
+    struct journal_segment *segment = malloc(sizeof(*segment));
+    if (segment == NULL) {
+        return NULL;
+    }
+    segment->base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (segment->base == MAP_FAILED) {
+        perror("[ERROR] Gagal mmap segmen journal");
+        free(segment);
+        return NULL;
+    }
+    segment->id = id;
+    segment->size = size;
+    segment->header = (struct journal_segment_header *)segment->base;
+    atomic_init(&segment->refcount, 1);
+    return segment;
+}
+
+static int add_segment(struct journal_segment *segment) {
+    if (segment_count == segment_capacity) {
+        size_t capacity = segment_capacity > 0 ? segment_capacity * 2 : 16;
+        struct journal_segment **grown = realloc(segments, capacity * sizeof(*grown));
+        if (grown == NULL) {
+            return -1;
+        }
+        segments = grown;
+        segment_capacity = capacity;
+    }
+    segments[segment_count++] = segment;
+    return 0;
+}
+
+// Menghapus segmen tertua sampai jumlahnya sesuai batas retensi. Lock hanya
+// dipegang selama segmen dikeluarkan dari daftar; unlink dan munmap dilakukan
+// di luar lock, dan mapping baru dilepas setelah buffer riwayat terakhir
+// selesai dikirim.
+static void enforce_retention(void) {
+    while (1) {
+        pthread_rwlock_wrlock(&journal_lock);
+        if (segment_count <= journal_cfg.max_segments || segment_count <= 1) {
+            pthread_rwlock_unlock(&journal_lock);
+            break;
+        }
+        struct journal_segment *oldest = segments[0];
+        memmove(segments, segments + 1, (segment_count - 1) * sizeof(*segments));
+        segment_count--;
+        pthread_rwlock_unlock(&journal_lock);
+
+        char path[4096];
+        segment_path(path, sizeof(path), oldest->id);
+        if (unlink(path) < 0) {
+            perror("[WARN] Gagal menghapus segmen journal");
+        }
+        segment_release(oldest);
+    }
+}
+
+// Membuat file segmen baru dengan nama sementara dan me-mmap-nya. Segmen
+// belum terlihat oleh pembaca sampai activate_segment() dipanggil.
+static struct journal_segment *prepare_segment(uint32_t id) {
+    char path[4096];
+    spare_path(path, sizeof(path), id);
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        perror("[ERROR] Gagal membuat segmen journal");
+        return NULL;
+    }
+    if (ftruncate(fd, (off_t)journal_cfg.segment_size) < 0) {
+        perror("[ERROR] Gagal mengatur ukuran segmen journal");
+        close(fd);
+        unlink(path);
+        return NULL;
+    }
+    struct journal_segment *segment = map_segment(id, fd, journal_cfg.segment_size);
+    close(fd);
+    if (segment == NULL) {
+        unlink(path);
+        return NULL;
+    }
+
+    struct journal_segment_header *header = segment->header;
+    header->version = JOURNAL_VERSION;
+    header->segment_id = id;
+    header->size = journal_cfg.segment_size;
+    header->record_count = 0;
+    header->index_count = 0;
+    header->room_tail_count = 0;
+    atomic_store_explicit(&header->committed, JOURNAL_HEADER_SIZE, memory_order_relaxed);
+    return segment;
+}
+
+// Menjadikan segmen yang sudah disiapkan sebagai segmen aktif. Tail semua
+// room disalin ke header-nya agar saat restart cukup segmen terakhir yang dibaca.
+static int activate_segment(struct journal_segment *segment) {
+    struct journal_segment_header *header = segment->header;
+    for (size_t i = 0; i < tail_capacity && header->room_tail_count < JOURNAL_ROOM_TAILS_MAX; i++) {
+        uint64_t position = atomic_load_explicit(&tails[i].position, memory_order_relaxed);
+        if (tails[i].len != 0 && position != 0) {
+            struct journal_room_tail *tail = &header->room_tails[header->room_tail_count++];
+            tail->position = position;
+            tail->len = tails[i].len;
+            memcpy(tail->name, tails[i].name, tails[i].len);
+        }
+    }
+    // Magic ditulis terakhir: segmen tanpa magic dianggap rusak saat restart
+    memcpy(header->magic, JOURNAL_MAGIC, 8);
+
+    char from[4096], to[4096];
+    spare_path(from, sizeof(from), segment->id);
+    segment_path(to, sizeof(to), segment->id);
+    if (rename(from, to) < 0) {
+        perror("[ERROR] Gagal mengaktifkan segmen journal");
+        unlink(from);
+        segment_release(segment);
+        return -1;
+    }
+
+    pthread_rwlock_wrlock(&journal_lock);
+    int rc = add_segment(segment);
+    pthread_rwlock_unlock(&journal_lock);
+    if (rc < 0) {
+        segment_release(segment);
+        return -1;
+    }
+    return 0;
+}
+
+// Membaca ulang record di segmen terakhir untuk memperbarui tail room yang
+// dimuat dari header segmen itu
+static void recover_tails(struct journal_segment *segment) {
+    struct journal_segment_header *header = segment->header;
+    for (uint32_t i = 0; i < header->room_tail_count && i < JOURNAL_ROOM_TAILS_MAX; i++) {
+        struct journal_room_tail *saved = &header->room_tails[i];
+        if (saved->len == 0 || saved->len > CHAT_ROOM_MAX) {
+            continue;
+        }
+        struct room_tail_slot *slot = tail_lookup(saved->name, saved->len, 1);
+        if (slot != NULL) {
+            atomic_store_explicit(&slot->position, saved->position, memory_order_relaxed);
+        }
+    }
+
+    uint64_t committed = atomic_load_explicit(&header->committed, memory_order_acquire);
+    if (committed > segment->size) {
+        committed = segment->size;
+    }
+    uint64_t offset = JOURNAL_HEADER_SIZE;
+    uint64_t records = 0;
+    const struct journal_record *record;
+    while ((record = journal_record_at(segment->base, committed, offset)) != NULL) {
+        const char *sender, *room, *text;
+        size_t sender_len, room_len, text_len;
+        if (journal_record_fields(record, &sender, &sender_len, &room, &room_len, &text, &text_len) < 0 ||
+            room_len == 0 || room_len > CHAT_ROOM_MAX) {
+            break;
+        }
+        struct room_tail_slot *slot = tail_lookup(room, room_len, 1);
+        if (slot != NULL) {
+            atomic_store_explicit(&slot->position, JOURNAL_POSITION(segment->id, offset), memory_order_relaxed);
+        }
+        offset += JOURNAL_RECORD_SIZE(record->length);
+        records++;
+    }
+    // Potong record terakhir yang tidak lengkap (misalnya server mati saat menulis)
+    atomic_store_explicit(&header->committed, offset, memory_order_release);
+    header->record_count = records;
+}
+
+static int compare_ids(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Menyalin satu pesan ke segmen aktif. Hanya dipanggil thread journal.
+static void write_entry(const struct journal_entry *entry) {
+    size_t record_size = JOURNAL_RECORD_SIZE(entry->frame->length);
+    struct journal_segment *segment = segments[segment_count - 1];
+    uint64_t offset = atomic_load_explicit(&segment->header->committed, memory_order_relaxed);
+    if (offset + record_size > segment->size) {
+        // Segmen penuh: pindah ke segmen yang sudah disiapkan, lalu terapkan
+        // retensi. Jika segmen itu tidak ada atau gagal diaktifkan (misalnya
+        // file sementaranya dihapus proses lain saat hot restart), buat sekarang.
+        msync(segment->base, segment->size, MS_ASYNC);
+        struct journal_segment *next = spare;
+        spare = NULL;
+        spare_wanted = 1;
+        int rc = next != NULL ? activate_segment(next) : -1;
+        if (rc < 0) {
+            next = prepare_segment(segment->id + 1);
+            rc = next != NULL ? activate_segment(next) : -1;
+        }
+        if (rc < 0) {
+            fprintf(stderr, "[WARN] Gagal menyimpan pesan #%.*s ke journal\n", (int)entry->room_len, entry->room);
+            return;
+        }
+        enforce_retention();
+        segment = next;
+        offset = JOURNAL_HEADER_SIZE;
+    }
+
+    // Room baru mengubah tabel tail, jadi hanya saat itu lock eksklusif diambil
+    struct room_tail_slot *tail = tail_lookup(entry->room, entry->room_len, 0);
+    if (tail == NULL) {
+        pthread_rwlock_wrlock(&journal_lock);
+        tail = tail_lookup(entry->room, entry->room_len, 1);
+        pthread_rwlock_unlock(&journal_lock);
+    }
+    struct journal_record *record = (struct journal_record *)(segment->base + offset);
+    record->length = (uint32_t)entry->frame->length;
+    record->reserved = 0;
+    record->timestamp_us = entry->timestamp_us;
+    record->prev = tail != NULL ? atomic_load_explicit(&tail->position, memory_order_relaxed) : 0;
+    memcpy(record->frame, entry->frame->data, entry->frame->length);
+    // Salinan di journal ditandai sebagai riwayat, frame live tidak berubah
+    record->frame[2] = (char)(CHAT_FLAG_HISTORY >> 8);
+    record->frame[3] = (char)(CHAT_FLAG_HISTORY & 0xff);
+
+    struct journal_segment_header *header = segment->header;
+    if (header->record_count % JOURNAL_INDEX_INTERVAL == 0 && header->index_count < JOURNAL_INDEX_MAX) {
+        header->index[header->index_count].timestamp_us = record->timestamp_us;
+        header->index[header->index_count].offset = offset;
+        header->index_count++;
+    }
+    header->record_count++;
+    // committed dipublikasikan sebelum tail room, jadi replay yang membaca
+    // posisi baru selalu menemukan record yang lengkap
+    atomic_store_explicit(&header->committed, offset + record_size, memory_order_release);
+    if (tail != NULL) {
+        atomic_store_explicit(&tail->position, JOURNAL_POSITION(segment->id, offset), memory_order_release);
+    }
+}
+
+static void *journal_thread_main(void *arg) {
+    (void)arg;
+    unsigned long reported_dropped = 0;
+    while (1) {
+        int running = atomic_load(&journal_running);
+
+        struct journal_entry *entry;
+        while ((entry = chat_ring_peek(&journal_queue)) != NULL) {
+            write_entry(entry);
+            chat_buffer_release(entry->frame);
+            chat_ring_consume(&journal_queue);
+        }
+
+        unsigned long dropped = atomic_load_explicit(&journal_dropped, memory_order_relaxed);
+        if (dropped != reported_dropped) {
+            fprintf(stderr, "[WARN] Antrian journal penuh, %lu pesan tidak disimpan (total %lu)\n",
+                    dropped - reported_dropped, dropped);
+            reported_dropped = dropped;
+        }
+
+        if (!running) {
+            break;
+        }
+
+        // Segmen berikutnya disiapkan saat antrian kosong, bukan saat segmen penuh
+        if (spare_wanted) {
+            spare = prepare_segment(segments[segment_count - 1]->id + 1);
+            spare_wanted = 0;
+        }
+        uint64_t count;
+        if (read(journal_wake_fd, &count, sizeof(count)) < 0 && errno != EINTR) {
+            perror("eventfd read");
+        }
+        // Reset flag sebelum mengosongkan antrian agar tidak ada wakeup yang hilang
+        atomic_store(&journal_wake_pending, 0);
+    }
+    return NULL;
+}
+
+static int start_writer(void) {
+    atomic_store(&journal_running, 1);
+    if (pthread_create(&journal_thread, NULL, journal_thread_main, NULL) != 0) {
+        perror("[ERROR] Gagal menjalankan thread journal");
+        atomic_store(&journal_running, 0);
+        return -1;
+    }
+    return 0;
+}
+
+// Membangunkan thread journal yang journal_running-nya sudah 0 dan menunggunya
+// selesai menulis sisa antrian
+static void stop_writer(void) {
+    uint64_t one = 1;
+    if (write(journal_wake_fd, &one, sizeof(one)) < 0) {
+        perror("eventfd write");
+    }
+    pthread_join(journal_thread, NULL);
+}
+
+int journal_open(const struct journal_config *config) {
+    journal_cfg = *config;
+    if (journal_cfg.dir == NULL) {
+        return 0;
+    }
+    if (journal_cfg.segment_size < JOURNAL_HEADER_SIZE * 2 || journal_cfg.segment_size > UINT32_MAX) {
+        fprintf(stderr, "[ERROR] Ukuran segmen journal tidak valid\n");
+        return -1;
+    }
+    if (journal_cfg.max_segments < 1) {
+        journal_cfg.max_segments = 1;
+    }
+    if (mkdir(journal_cfg.dir, 0755) < 0 && errno != EEXIST) {
+        perror("[ERROR] Gagal membuat direktori journal");
+        return -1;
+    }
+
+    // Daftar segmen diambil dari nama file saja, isi segmen lama tidak dibaca
+    DIR *dir = opendir(journal_cfg.dir);
+    if (dir == NULL) {
+        perror("[ERROR] Gagal membuka direktori journal");
+        return -1;
+    }
+    uint32_t *ids = NULL;
+    size_t id_count = 0, id_capacity = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        unsigned int id;
+        char suffix[8];
+        if (sscanf(entry->d_name, "%8u.%7s", &id, suffix) != 2 || strcmp(suffix, "jnl") != 0 || id == 0) {
+            continue;
+        }
+        if (id_count == id_capacity) {
+            id_capacity = id_capacity > 0 ? id_capacity * 2 : 16;
+            uint32_t *grown = realloc(ids, id_capacity * sizeof(*ids));
+            if (grown == NULL) {
+                free(ids);
+                closedir(dir);
+                return -1;
+            }
+            ids = grown;
+        }
+        ids[id_count++] = id;
+    }
+    closedir(dir);
+    qsort(ids, id_count, sizeof(*ids), compare_ids);
+
+    for (size_t i = 0; i < id_count; i++) {
+        char path[4096];
+        segment_path(path, sizeof(path), ids[i]);
+        int fd = open(path, O_RDWR | O_CLOEXEC);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) < 0) {
+            perror("[WARN] Gagal membuka segmen journal");
+            if (fd >= 0) {
+                close(fd);
+            }
+            continue;
+        }
+        struct journal_segment *segment = map_segment(ids[i], fd, (size_t)st.st_size);
+        close(fd);
+        if (segment == NULL) {
+            continue;
+        }
+        if (!journal_segment_valid(segment->header, segment->size) || segment->header->segment_id != ids[i]) {
+            fprintf(stderr, "[WARN] Segmen journal %s rusak, diabaikan\n", path);
+            segment_release(segment);
+            continue;
+        }
+        if (add_segment(segment) < 0) {
+            segment_release(segment);
+        }
+    }
+    free(ids);
+
+    if (segment_count > 0) {
+        struct journal_segment *last = segments[segment_count - 1];
+        recover_tails(last);
+        // Segmen dengan ukuran berbeda dari konfigurasi sekarang tetap dipakai sampai penuh
+        printf("[INFO] Journal: %zu segmen, melanjutkan segmen %u (%llu record)\n", segment_count, last->id,
+               (unsigned long long)last->header->record_count);
+    } else {
+        struct journal_segment *first = prepare_segment(1);
+        if (first == NULL || activate_segment(first) < 0) {
+            return -1;
+        }
+    }
+    enforce_retention();
+
+    if (chat_ring_init(&journal_queue, JOURNAL_QUEUE_SIZE, sizeof(struct journal_entry)) < 0) {
+        perror("[ERROR] Gagal membuat antrian journal");
+        return -1;
+    }
+    journal_wake_fd = eventfd(0, EFD_CLOEXEC);
+    if (journal_wake_fd < 0) {
+        perror("eventfd");
+        return -1;
+    }
+    spare_wanted = 1;
+    if (start_writer() < 0) {
+        return -1;
+    }
+    journal_opened = 1;
+    return 0;
+}
+
+// Membuang segmen cadangan yang belum dipakai beserta file sementaranya
+static void discard_spare(void) {
+    if (spare != NULL) {
+        char path[4096];
+        spare_path(path, sizeof(path), spare->id);
+        unlink(path);
+        segment_release(spare);
+        spare = NULL;
+    }
+}
+
+void journal_flush(void) {
+    if (!atomic_exchange(&journal_running, 0)) {
+        return;
+    }
+    stop_writer();
+    // Server baru akan menyiapkan segmen cadangannya sendiri dengan nama yang sama
+    discard_spare();
+    spare_wanted = 1;
+    struct journal_segment *active = segments[segment_count - 1];
+    msync(active->base, active->size, MS_ASYNC);
+}
+
+void journal_resume(void) {
+    if (journal_opened && !atomic_load(&journal_running)) {
+        start_writer();
+    }
+}
+
+void journal_close(void) {
+    if (!journal_opened) {
+        return;
+    }
+    if (atomic_exchange(&journal_running, 0)) {
+        stop_writer();
+    }
+    struct journal_entry entry;
+    while (chat_ring_pop(&journal_queue, &entry)) {
+        chat_buffer_release(entry.frame);
+    }
+    chat_ring_destroy(&journal_queue);
+    close(journal_wake_fd);
+    journal_wake_fd = -1;
+    discard_spare();
+
+    pthread_rwlock_wrlock(&journal_lock);
+    for (size_t i = 0; i < segment_count; i++) {
+        msync(segments[i]->base, segments[i]->size, MS_ASYNC);
+        segment_release(segments[i]);
+    }
+    free(segments);
+    segments = NULL;
+    segment_count = segment_capacity = 0;
+    free(tails);
+    tails = NULL;
+    tail_capacity = tail_count = 0;
+    journal_opened = 0;
+    pthread_rwlock_unlock(&journal_lock);
+}
+
+int journal_append(const char *room, size_t room_len, const struct chat_buffer *frame) {
+    if (!atomic_load_explicit(&journal_running, memory_order_acquire)) {
+        // Journal mati, ditahan selama serah terima, atau sudah ditutup saat server berhenti
+        return 0;
+    }
+    if (JOURNAL_RECORD_SIZE(frame->length) > journal_cfg.segment_size - JOURNAL_HEADER_SIZE ||
+        room_len > CHAT_ROOM_MAX) {
+        return -1;
+    }
+
+    size_t pos;
+    struct journal_entry *entry = chat_ring_claim(&journal_queue, &pos);
+    if (entry == NULL) {
+        atomic_fetch_add_explicit(&journal_dropped, 1, memory_order_relaxed);
+        return 0;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    chat_buffer_retain((struct chat_buffer *)frame);
+    entry->frame = (struct chat_buffer *)frame;
+    entry->timestamp_us = (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+    entry->room_len = (unsigned char)room_len;
+    memcpy(entry->room, room, room_len);
+    chat_ring_publish(&journal_queue, pos);
+
+    // Hanya satu write(eventfd) selama thread journal belum bangun
+    if (!atomic_exchange(&journal_wake_pending, 1)) {
+        uint64_t one = 1;
+        if (write(journal_wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+            perror("eventfd write");
+        }
+    }
+    return 0;
+}
+
+size_t journal_replay(const char *room, size_t room_len, size_t limit, struct chat_buffer **out) {
+    struct journal_segment *owners[JOURNAL_HISTORY_MAX];
+    const struct journal_record *records[JOURNAL_HISTORY_MAX];
+    size_t found = 0;
+    if (journal_cfg.dir == NULL || limit == 0) {
+        return 0;
+    }
+    if (limit > JOURNAL_HISTORY_MAX) {
+        limit = JOURNAL_HISTORY_MAX;
+    }
+
+    // Hanya mengikuti rantai pointer di memori lewat posisi dan committed yang
+    // dipublikasikan thread journal. Lock bersama hanya menjaga segmen agar
+    // tidak dilepas retensi selama rantai diikuti; replay lain dan penulisan
+    // record baru tetap berjalan.
+    pthread_rwlock_rdlock(&journal_lock);
+    struct room_tail_slot *tail = journal_opened ? tail_lookup(room, room_len, 0) : NULL;
+    uint64_t position = tail != NULL ? atomic_load_explicit(&tail->position, memory_order_acquire) : 0;
+    while (position != 0 && found < limit) {
+        struct journal_segment *segment = find_segment(JOURNAL_POSITION_SEGMENT(position));
+        if (segment == NULL) {
+            break; // Segmen sudah dihapus retensi
+        }
+        uint64_t committed = atomic_load_explicit(&segment->header->committed, memory_order_acquire);
+        const struct journal_record *record =
+            journal_record_at(segment->base, committed, JOURNAL_POSITION_OFFSET(position));
+        if (record == NULL) {
+            break;
+        }
+        atomic_fetch_add_explicit(&segment->refcount, 1, memory_order_relaxed);
+        owners[found] = segment;
+        records[found] = record;
+        found++;
+        position = record->prev;
+    }
+    pthread_rwlock_unlock(&journal_lock);
+
+    // Rantai berjalan dari yang terbaru; urutan kirim dibalik agar terlama lebih dulu
+    size_t count = 0;
+    for (size_t i = found; i-- > 0;) {
+        struct chat_buffer *buf = chat_buffer_external(records[i]->frame, records[i]->length, segment_release, owners[i]);
+        if (buf == NULL) {
+            segment_release(owners[i]);
+            continue;
+        }
+        out[count++] = buf;
+    }
+    return count;
+}
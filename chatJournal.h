@@ -0,0 +1,117 @@
+#ifndef CHAT_JOURNAL_H
+#define CHAT_JOURNAL_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "chatProtocol.h"
+#include "chatQueue.h"
+
+// Journal pesan biner: file segmen berukuran tetap di satu direktori
+// (00000001.jnl, 00000002.jnl, ...) yang ditulis lewat mmap. Setiap segmen:
+//
+//   +---------------------------------------------+ 0
+//   | header: magic, id, committed, jumlah record |
+//   | tail room saat segmen dibuat                |
+//   | indeks jarang (waktu -> offset)             |
+//   +---------------------------------------------+ JOURNAL_HEADER_SIZE
+//   | record | record | ...                       |
+//   +---------------------------------------------+ committed
+//
+// Setiap record berisi frame CHAT utuh seperti yang dikirim ke klien (dengan
+// flag CHAT_FLAG_HISTORY), sehingga riwayat bisa dikirim langsung dari
+// halaman yang di-mmap tanpa salinan. Record juga menunjuk ke record
+// sebelumnya di room yang sama, jadi N pesan terakhir suatu room didapat
+// tanpa memindai journal.
+
+#define JOURNAL_MAGIC "CHATJNL1"
+#define JOURNAL_VERSION 1
+#define JOURNAL_HEADER_SIZE (128 * 1024)
+#define JOURNAL_INDEX_INTERVAL 256  // satu entri indeks setiap 256 record
+#define JOURNAL_INDEX_MAX 4096
+#define JOURNAL_ROOM_TAILS_MAX 512
+#define JOURNAL_HISTORY_MAX 256     // batas pesan riwayat per replay
+
+// Posisi record: id segmen (32 bit atas) dan offset di dalam segmen.
+// Posisi 0 berarti tidak ada (offset record tidak pernah 0).
+#define JOURNAL_POSITION(segment, offset) (((uint64_t)(segment) << 32) | (uint64_t)(offset))
+#define JOURNAL_POSITION_SEGMENT(pos) ((uint32_t)((pos) >> 32))
+#define JOURNAL_POSITION_OFFSET(pos) ((uint32_t)(pos))
+
+struct journal_index_entry {
+    int64_t timestamp_us;
+    uint64_t offset;
+};
+
+struct journal_room_tail {
+    uint64_t position;
+    unsigned char len;
+    char name[CHAT_ROOM_MAX + 7];
+};
+
+struct journal_segment_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t segment_id;
+    uint64_t size;                // ukuran file segmen
+    _Atomic uint64_t committed;   // akhir record yang sudah lengkap
+    uint64_t record_count;
+    uint32_t index_count;
+    uint32_t room_tail_count;
+    char reserved[16];
+    struct journal_room_tail room_tails[JOURNAL_ROOM_TAILS_MAX];
+    struct journal_index_entry index[JOURNAL_INDEX_MAX];
+};
+
+_Static_assert(sizeof(struct journal_segment_header) <= JOURNAL_HEADER_SIZE, "header journal terlalu besar");
+
+struct journal_record {
+    uint32_t length;       // panjang frame (header + payload)
+    uint32_t reserved;
+    int64_t timestamp_us;  // waktu realtime saat ditulis
+    uint64_t prev;         // posisi record sebelumnya di room yang sama
+    char frame[];
+};
+
+// Ukuran record di file, dibulatkan ke 8 byte
+#define JOURNAL_RECORD_SIZE(frame_length) ((sizeof(struct journal_record) + (frame_length) + 7) & ~(size_t)7)
+
+struct journal_config {
+    const char *dir;            // NULL = journal mati
+    size_t segment_size;        // ukuran satu segmen dalam byte
+    unsigned int max_segments;  // segmen tertua dihapus jika jumlahnya melebihi ini
+};
+
+// Membuka atau membuat journal. Hanya segmen terakhir yang dibaca ulang untuk
+// memulihkan tail room; segmen lama hanya di-mmap. 0 jika berhasil.
+int journal_open(const struct journal_config *config);
+void journal_close(void);
+
+// Dipakai saat serah terima ke server baru: journal_flush() menunggu thread
+// journal menulis semua isi antriannya ke segmen lalu menghentikannya, sehingga
+// server baru bisa membuka segmen yang sama tanpa ada penulis lain. Selama
+// berhenti, journal_append() tidak menyimpan apa pun. journal_resume()
+// menjalankan thread journal lagi jika serah terima gagal.
+void journal_flush(void);
+void journal_resume(void);
+
+// Menyerahkan frame CHAT yang sudah di-encode ke thread journal (frame ditahan
+// satu referensi sampai disalin). Aman dipanggil dari shard mana pun dan tidak
+// pernah menunggu lock atau I/O; jika antrian penuh pesan dibuang dan
+// dihitung. 0 jika diterima atau journal mati, -1 jika frame tidak bisa disimpan.
+int journal_append(const char *room, size_t room_len, const struct chat_buffer *frame);
+
+// Mengisi out dengan paling banyak limit pesan terakhir room (terlama lebih
+// dulu) sebagai buffer yang menunjuk langsung ke halaman journal. Setiap
+// buffer menahan segmennya tetap ter-mmap sampai dilepas. Pesan yang masih di
+// antrian thread journal belum ikut.
+size_t journal_replay(const char *room, size_t room_len, size_t limit, struct chat_buffer **out);
+
+// Fungsi baca yang juga dipakai alat ekspor offline
+int journal_segment_valid(const struct journal_segment_header *header, size_t file_size);
+const struct journal_record *journal_record_at(const char *base, uint64_t committed, uint64_t offset);
+int journal_record_fields(const struct journal_record *record, const char **sender, size_t *sender_len,
+                          const char **room, size_t *room_len, const char **text, size_t *text_len);
+
+#endif
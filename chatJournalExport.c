@@ -0,0 +1,192 @@
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "chatJournal.h"
+
+// Filter ekspor dari command line
+struct export_filter {
+    int64_t since_us;   // 0 = semua
+    const char *room;   // NULL = semua room
+};
+
+// Offset record pertama yang mungkin >= since, dicari lewat indeks jarang
+// (binary search) agar tidak perlu membaca segmen dari awal
+uint64_t find_start_offset(const struct journal_segment_header *header, int64_t since_us) {
+    uint32_t count = header->index_count < JOURNAL_INDEX_MAX ? header->index_count : JOURNAL_INDEX_MAX;
+    uint32_t low = 0, high = count;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        if (header->index[mid].timestamp_us < since_us) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    // Entri sebelum posisi ini masih bisa berisi record dengan waktu >= since
+    return low > 0 ? header->index[low - 1].offset : JOURNAL_HEADER_SIZE;
+}
+
+// Mencetak isi satu segmen dalam format chat_log.txt: "[waktu] [CHAT] user: pesan"
+int export_segment(const char *path, const struct export_filter *filter) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+    const char *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror(path);
+        return -1;
+    }
+
+    const struct journal_segment_header *header = (const struct journal_segment_header *)base;
+    if (!journal_segment_valid(header, (size_t)st.st_size)) {
+        fprintf(stderr, "%s: bukan segmen journal yang valid\n", path);
+        munmap((void *)base, (size_t)st.st_size);
+        return -1;
+    }
+
+    uint64_t committed = atomic_load(&((struct journal_segment_header *)header)->committed);
+    if (committed > (uint64_t)st.st_size) {
+        committed = (uint64_t)st.st_size;
+    }
+    uint64_t offset = filter->since_us > 0 ? find_start_offset(header, filter->since_us) : JOURNAL_HEADER_SIZE;
+    size_t room_filter_len = filter->room != NULL ? strlen(filter->room) : 0;
+
+    time_t cached_second = -1;
+    char time_text[32] = "";
+    const struct journal_record *record;
+    while ((record = journal_record_at(base, committed, offset)) != NULL) {
+        offset += JOURNAL_RECORD_SIZE(record->length);
+        if (record->timestamp_us < filter->since_us) {
+            continue;
+        }
+
+        const char *sender, *room, *text;
+        size_t sender_len, room_len, text_len;
+        if (journal_record_fields(record, &sender, &sender_len, &room, &room_len, &text, &text_len) < 0) {
+            fprintf(stderr, "%s: record rusak pada offset %llu\n", path, (unsigned long long)offset);
+            break;
+        }
+        if (filter->room != NULL && (room_len != room_filter_len || memcmp(room, filter->room, room_len) != 0)) {
+            continue;
+        }
+
+        time_t second = (time_t)(record->timestamp_us / 1000000);
+        if (second != cached_second) {
+            struct tm t;
+            localtime_r(&second, &t);
+            strftime(time_text, sizeof(time_text), "%Y-%m-%d %H:%M:%S", &t);
+            cached_second = second;
+        }
+        // Room selain room default ditandai di depan pesan, sama seperti log server
+        if (room_len == strlen(CHAT_DEFAULT_ROOM) && memcmp(room, CHAT_DEFAULT_ROOM, room_len) == 0) {
+            printf("[%s] [CHAT] %.*s: %.*s\n", time_text, (int)sender_len, sender, (int)text_len, text);
+        } else {
+            printf("[%s] [CHAT] %.*s: [#%.*s] %.*s\n", time_text, (int)sender_len, sender, (int)room_len, room,
+                   (int)text_len, text);
+        }
+    }
+
+    munmap((void *)base, (size_t)st.st_size);
+    return 0;
+}
+
+// Mengekspor semua segmen di direktori, urut dari segmen tertua
+int export_directory(const char *path, const struct export_filter *filter) {
+    struct dirent **entries;
+    int n = scandir(path, &entries, NULL, alphasort);
+    if (n < 0) {
+        perror(path);
+        return -1;
+    }
+    int rc = 0;
+    for (int i = 0; i < n; i++) {
+        size_t len = strlen(entries[i]->d_name);
+        if (len > 4 && strcmp(entries[i]->d_name + len - 4, ".jnl") == 0) {
+            char segment[4096];
+            snprintf(segment, sizeof(segment), "%s/%s", path, entries[i]->d_name);
+            if (export_segment(segment, filter) < 0) {
+                rc = -1;
+            }
+        }
+        free(entries[i]);
+    }
+    free(entries);
+    return rc;
+}
+
+void print_usage(const char *prog) {
+    printf("Penggunaan: %s [opsi] <segmen.jnl | direktori journal> ...\n", prog);
+    printf("  --since \"YYYY-MM-DD HH:MM:SS\"  hanya pesan sejak waktu ini (waktu lokal)\n");
+    printf("  --room NAME                     hanya pesan dari room ini\n");
+}
+
+int main(int argc, char *argv[]) {
+    static const struct option long_options[] = {
+        {"since", required_argument, NULL, 's'},
+        {"room", required_argument, NULL, 'r'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+
+    struct export_filter filter = {0, NULL};
+    int opt;
+    while ((opt = getopt_long(argc, argv, "s:r:h", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 's': {
+            struct tm t;
+            memset(&t, 0, sizeof(t));
+            char *end = strptime(optarg, "%Y-%m-%d %H:%M:%S", &t);
+            if (end == NULL || *end != '\0') {
+                fprintf(stderr, "Format waktu tidak valid: %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            t.tm_isdst = -1;
+            filter.since_us = (int64_t)mktime(&t) * 1000000;
+            break;
+        }
+        case 'r':
+            filter.room = optarg;
+            break;
+        default:
+            print_usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (optind >= argc) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int rc = EXIT_SUCCESS;
+    for (int i = optind; i < argc; i++) {
+        struct stat st;
+        if (stat(argv[i], &st) < 0) {
+            perror(argv[i]);
+            rc = EXIT_FAILURE;
+            continue;
+        }
+        int result = S_ISDIR(st.st_mode) ? export_directory(argv[i], &filter) : export_segment(argv[i], &filter);
+        if (result < 0) {
+            rc = EXIT_FAILURE;
+        }
+    }
+    return rc;
+}
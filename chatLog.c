@@ -0,0 +1,219 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "chatLog.h"
+#include "chatRing.h"
+
+#define LOG_LEVEL_MAX 8
+#define LOG_USERNAME_MAX 64
+#define LOG_TEXT_MAX 1024
+#define LOG_WRITE_BUFFER (256 * 1024)
+
+// Satu baris log. Ditulis langsung ke slot antrian oleh produsen dan
+// diformat menjadi teks oleh thread logger.
+struct log_record {
+    time_t timestamp;
+    unsigned short username_len;
+    unsigned short text_len;
+    char level[LOG_LEVEL_MAX];
+    char username[LOG_USERNAME_MAX];
+    char text[LOG_TEXT_MAX];
+};
+
+static struct chat_ring log_queue;
+static struct log_config log_cfg;
+static int log_fd = -1;
+static pthread_t log_thread;
+static atomic_int log_running;
+static atomic_ulong log_dropped;
+
+// Buffer tulis milik thread logger
+static char write_buffer[LOG_WRITE_BUFFER];
+static size_t write_len;
+
+// Cache string waktu: strftime hanya dipanggil sekali per detik
+static time_t cached_second = -1;
+static char cached_time[20];
+
+static size_t copy_field(char *dst, size_t cap, const char *src) {
+    if (src == NULL) {
+        return 0;
+    }
+    size_t len = strnlen(src, cap);
+    memcpy(dst, src, len);
+    return len;
+}
+
+void log_message(const char *level, const char *username, const char *message) {
+    log_message_len(level, username, message, strnlen(message, LOG_TEXT_MAX));
+}
+
+void log_message_len(const char *level, const char *username, const char *message, size_t length) {
+    size_t pos;
+    struct log_record *rec = chat_ring_claim(&log_queue, &pos);
+    if (rec == NULL) {
+        atomic_fetch_add_explicit(&log_dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    rec->timestamp = time(NULL);
+    memset(rec->level, 0, sizeof(rec->level));
+    copy_field(rec->level, sizeof(rec->level) - 1, level);
+    rec->username_len = copy_field(rec->username, sizeof(rec->username), username);
+    // Pesan yang lebih panjang dari LOG_TEXT_MAX dipotong di log
+    rec->text_len = length < sizeof(rec->text) ? length : sizeof(rec->text);
+    memcpy(rec->text, message, rec->text_len);
+    chat_ring_publish(&log_queue, pos);
+}
+
+unsigned long log_dropped_count(void) {
+    return atomic_load_explicit(&log_dropped, memory_order_relaxed);
+}
+
+size_t log_backlog(void) {
+    return log_fd >= 0 ? chat_ring_count(&log_queue) : 0;
+}
+
+static void flush_buffer(void) {
+    size_t off = 0;
+    while (off < write_len) {
+        ssize_t n = write(log_fd, write_buffer + off, write_len - off);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("[ERROR] Gagal menulis file log");
+            break;
+        }
+        off += n;
+    }
+    write_len = 0;
+}
+
+static const char *format_time(time_t now) {
+    if (now != cached_second) {
+        struct tm t;
+        localtime_r(&now, &t);
+        if (strftime(cached_time, sizeof(cached_time), "%Y-%m-%d %H:%M:%S", &t) == 0) {
+            fprintf(stderr, "[ERROR] Gagal memformat waktu untuk log\n");
+            cached_time[0] = '\0';
+        }
+        cached_second = now;
+    }
+    return cached_time;
+}
+
+// Format baris sama seperti sebelumnya: "[waktu] [LEVEL] username: pesan"
+static void append_record(const struct log_record *rec) {
+    // Baris terpanjang: waktu + level + username + teks + pemisah
+    if (write_len + LOG_TEXT_MAX + LOG_USERNAME_MAX + 64 > sizeof(write_buffer)) {
+        flush_buffer();
+    }
+
+    char *out = write_buffer + write_len;
+    int n;
+    if (rec->username_len > 0) {
+        n = sprintf(out, "[%s] [%s] %.*s: %.*s\n", format_time(rec->timestamp), rec->level,
+                    (int)rec->username_len, rec->username, (int)rec->text_len, rec->text);
+    } else {
+        n = sprintf(out, "[%s] [%s] %.*s\n", format_time(rec->timestamp), rec->level,
+                    (int)rec->text_len, rec->text);
+    }
+    write_len += n;
+}
+
+static void *log_thread_main(void *arg) {
+    (void)arg;
+    unsigned long reported_dropped = 0;
+    time_t last_fsync = 0;
+    struct timespec interval;
+    interval.tv_sec = log_cfg.interval_ms / 1000;
+    interval.tv_nsec = (long)(log_cfg.interval_ms % 1000) * 1000000L;
+
+    while (1) {
+        int running = atomic_load(&log_running);
+
+        // Ambil semua record yang sudah ada sebagai satu batch
+        struct log_record *rec;
+        while ((rec = chat_ring_peek(&log_queue)) != NULL) {
+            append_record(rec);
+            chat_ring_consume(&log_queue);
+        }
+
+        // Laporkan record yang dibuang sejak batch sebelumnya
+        unsigned long dropped = log_dropped_count();
+        if (dropped != reported_dropped) {
+            struct log_record warn;
+            warn.timestamp = time(NULL);
+            strcpy(warn.level, "WARN");
+            warn.username_len = 0;
+            warn.text_len = snprintf(warn.text, sizeof(warn.text), "Antrian log penuh, %lu record dibuang (total %lu).",
+                                     dropped - reported_dropped, dropped);
+            append_record(&warn);
+            fprintf(stderr, "[WARN] %.*s\n", (int)warn.text_len, warn.text);
+            reported_dropped = dropped;
+        }
+
+        if (write_len > 0) {
+            flush_buffer();
+            time_t now = time(NULL);
+            if (log_cfg.fsync_policy == LOG_FSYNC_BATCH ||
+                (log_cfg.fsync_policy == LOG_FSYNC_SECOND && now != last_fsync)) {
+                fdatasync(log_fd);
+                last_fsync = now;
+            }
+        }
+
+        if (!running) {
+            break;
+        }
+        nanosleep(&interval, NULL);
+    }
+    return NULL;
+}
+
+int log_start(const struct log_config *config) {
+    log_cfg = *config;
+    if (log_cfg.interval_ms < 1) {
+        log_cfg.interval_ms = 1;
+    }
+
+    log_fd = open(log_cfg.path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (log_fd < 0) {
+        perror("[ERROR] Gagal membuka file log");
+        return -1;
+    }
+    if (chat_ring_init(&log_queue, log_cfg.queue_size, sizeof(struct log_record)) < 0) {
+        perror("[ERROR] Gagal membuat antrian log");
+        close(log_fd);
+        return -1;
+    }
+
+    atomic_store(&log_running, 1);
+    if (pthread_create(&log_thread, NULL, log_thread_main, NULL) != 0) {
+        perror("[ERROR] Gagal menjalankan thread logger");
+        return -1;
+    }
+    return 0;
+}
+
+void log_stop(void) {
+    if (log_fd < 0) {
+        return;
+    }
+    atomic_store(&log_running, 0);
+    pthread_join(log_thread, NULL);
+    if (log_cfg.fsync_policy != LOG_FSYNC_NONE) {
+        fdatasync(log_fd);
+    }
+    close(log_fd);
+    log_fd = -1;
+}
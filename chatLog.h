@@ -0,0 +1,40 @@
+#ifndef CHAT_LOG_H
+#define CHAT_LOG_H
+
+#include <stddef.h>
+
+// Kebijakan fsync untuk file log
+enum log_fsync_policy {
+    LOG_FSYNC_NONE,   // Serahkan ke page cache kernel
+    LOG_FSYNC_BATCH,  // fsync setelah setiap batch ditulis
+    LOG_FSYNC_SECOND  // fsync paling banyak sekali per detik
+};
+
+struct log_config {
+    const char *path;
+    int interval_ms;               // Interval group commit
+    enum log_fsync_policy fsync_policy;
+    size_t queue_size;             // Kapasitas antrian record
+};
+
+// Membuka file log dan menjalankan thread logger. Mengembalikan 0 jika berhasil.
+int log_start(const struct log_config *config);
+
+// Menulis semua record yang tersisa lalu menghentikan thread logger
+void log_stop(void);
+
+// Memasukkan satu record ke antrian logger tanpa I/O. Aman dipanggil dari
+// thread mana pun; jika antrian penuh record dibuang dan dihitung.
+void log_message(const char *level, const char *username, const char *message);
+
+// Sama seperti log_message(), untuk pesan yang tidak diakhiri '\0'
+// (misalnya payload frame yang dibaca langsung dari buffer parser)
+void log_message_len(const char *level, const char *username, const char *message, size_t length);
+
+// Jumlah record yang dibuang karena antrian penuh sejak server berjalan
+unsigned long log_dropped_count(void);
+
+// Perkiraan jumlah record yang menunggu ditulis thread logger
+size_t log_backlog(void);
+
+#endif
@@ -0,0 +1,384 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "chatLog.h"
+#include "chatMetrics.h"
+
+// Batas waktu melayani satu pembaca metrik agar klien macet tidak menahan thread
+#define SCRAPE_TIMEOUT_MS 1000
+
+// Jumlah semua slot pada satu titik waktu
+struct metrics_snapshot {
+    unsigned long accepted;
+    unsigned long rejected;
+    unsigned long sessions;
+    unsigned long timeouts;
+    unsigned long bytes_in;
+    unsigned long bytes_out;
+    unsigned long frames_in;
+    unsigned long frames_out;
+    unsigned long frames_dropped;
+    unsigned long throttled;
+    unsigned long duplicates;
+    unsigned long broadcasts;
+    unsigned long syscalls;
+    unsigned long log_backlog;
+    unsigned long log_dropped;
+    struct chat_histogram fanout;
+    struct chat_histogram delivery_ns;
+    struct chat_histogram queue_depth;
+};
+
+static struct shard_metrics *slots;
+static int slot_count;
+static struct metrics_config metrics_cfg;
+static pthread_t metrics_thread;
+static int listen_fd = -1;
+static int stop_fd = -1;
+static int running;
+
+// Batas bucket yang diekspor ke Prometheus (histogram internal jauh lebih rapat)
+static const double fanout_bounds[] = {1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000};
+static const double delivery_bounds[] = {0.00001, 0.00002, 0.00005, 0.0001, 0.0002, 0.0005, 0.001, 0.002,
+                                         0.005, 0.01, 0.02, 0.05, 0.1, 0.2, 0.5, 1, 2, 5};
+static const double depth_bounds[] = {1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 4096, 16384};
+
+uint64_t metrics_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+int metrics_init(int num_slots) {
+    size_t size = (size_t)num_slots * sizeof(struct shard_metrics);
+    slots = aligned_alloc(64, size);
+    if (slots == NULL) {
+        return -1;
+    }
+    memset(slots, 0, size);
+    for (int i = 0; i < num_slots; i++) {
+        chat_histogram_reset(&slots[i].fanout);
+        chat_histogram_reset(&slots[i].delivery_ns);
+        chat_histogram_reset(&slots[i].queue_depth);
+    }
+    slot_count = num_slots;
+    return 0;
+}
+
+struct shard_metrics *metrics_slot(int id) {
+    return &slots[id];
+}
+
+static unsigned long load(atomic_ulong *counter) {
+    return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+static void collect(struct metrics_snapshot *snap) {
+    memset(snap, 0, offsetof(struct metrics_snapshot, fanout));
+    chat_histogram_reset(&snap->fanout);
+    chat_histogram_reset(&snap->delivery_ns);
+    chat_histogram_reset(&snap->queue_depth);
+
+    for (int i = 0; i < slot_count; i++) {
+        struct shard_metrics *m = &slots[i];
+        snap->accepted += load(&m->accepted);
+        snap->rejected += load(&m->rejected);
+        snap->sessions += load(&m->sessions);
+        snap->timeouts += load(&m->timeouts);
+        snap->bytes_in += load(&m->bytes_in);
+        snap->bytes_out += load(&m->bytes_out);
+        snap->frames_in += load(&m->frames_in);
+        snap->frames_out += load(&m->frames_out);
+        snap->frames_dropped += load(&m->frames_dropped);
+        snap->throttled += load(&m->throttled);
+        snap->duplicates += load(&m->duplicates);
+        snap->broadcasts += load(&m->broadcasts);
+        snap->syscalls += load(&m->syscalls);
+        chat_histogram_merge(&snap->fanout, &m->fanout);
+        chat_histogram_merge(&snap->delivery_ns, &m->delivery_ns);
+        chat_histogram_merge(&snap->queue_depth, &m->queue_depth);
+    }
+    snap->log_backlog = log_backlog();
+    snap->log_dropped = log_dropped_count();
+}
+
+static void write_counter(FILE *out, const char *name, const char *help, const char *type, unsigned long value) {
+    fprintf(out, "# HELP %s %s\n# TYPE %s %s\n%s %lu\n", name, help, name, type, name, value);
+}
+
+// Histogram Prometheus dengan bucket kumulatif; scale mengubah satuan internal
+// (misalnya ns) ke satuan yang diekspor (detik)
+static void write_histogram(FILE *out, const char *name, const char *help, const struct chat_histogram *hist,
+                            const double *bounds, size_t bound_count, double scale) {
+    fprintf(out, "# HELP %s %s\n# TYPE %s histogram\n", name, help, name);
+    for (size_t i = 0; i < bound_count; i++) {
+        uint64_t limit = (uint64_t)(bounds[i] / scale);
+        fprintf(out, "%s_bucket{le=\"%g\"} %llu\n", name, bounds[i],
+                (unsigned long long)chat_histogram_count_below(hist, limit));
+    }
+    fprintf(out, "%s_bucket{le=\"+Inf\"} %llu\n", name, (unsigned long long)hist->count);
+    fprintf(out, "%s_sum %g\n%s_count %llu\n", name, (double)hist->sum * scale, name, (unsigned long long)hist->count);
+}
+
+static void write_prometheus(FILE *out, struct metrics_snapshot *snap) {
+    write_counter(out, "chat_accepted_total", "Koneksi yang diterima.", "counter", snap->accepted);
+    write_counter(out, "chat_rejected_total", "Koneksi yang ditolak karena server penuh atau laju koneksi terlalu tinggi.", "counter", snap->rejected);
+    write_counter(out, "chat_sessions", "Sesi klien aktif.", "gauge", snap->sessions);
+    write_counter(out, "chat_timeouts_total", "Sesi yang diputus karena timeout login, heartbeat, atau antrian kirim macet.", "counter", snap->timeouts);
+    fprintf(out, "# HELP chat_shard_sessions Sesi klien aktif per shard.\n# TYPE chat_shard_sessions gauge\n");
+    for (int i = 0; i < slot_count; i++) {
+        fprintf(out, "chat_shard_sessions{shard=\"%d\"} %lu\n", i, load(&slots[i].sessions));
+    }
+    write_counter(out, "chat_received_bytes_total", "Byte yang diterima dari klien.", "counter", snap->bytes_in);
+    write_counter(out, "chat_sent_bytes_total", "Byte yang dikirim ke klien.", "counter", snap->bytes_out);
+    write_counter(out, "chat_received_frames_total", "Frame yang diterima dari klien.", "counter", snap->frames_in);
+    write_counter(out, "chat_queued_frames_total", "Frame yang masuk ke antrian kirim klien.", "counter", snap->frames_out);
+    write_counter(out, "chat_dropped_frames_total", "Frame yang dibuang karena klien lambat.", "counter", snap->frames_dropped);
+    write_counter(out, "chat_throttled_frames_total", "Frame klien yang dibuang karena melewati batas laju pesan atau byte.", "counter", snap->throttled);
+    write_counter(out, "chat_duplicate_frames_total", "Frame klien yang dibuang karena payload-nya sama dengan pesan sebelumnya.", "counter", snap->duplicates);
+    write_counter(out, "chat_broadcasts_total", "Broadcast room yang diproses (per shard).", "counter", snap->broadcasts);
+    write_counter(out, "chat_syscalls_total", "Syscall I/O yang dilakukan event loop shard.", "counter", snap->syscalls);
+    write_counter(out, "chat_log_backlog", "Record yang menunggu ditulis thread logger.", "gauge", snap->log_backlog);
+    write_counter(out, "chat_log_dropped_total", "Record log yang dibuang karena antrian penuh.", "counter", snap->log_dropped);
+    write_histogram(out, "chat_broadcast_fanout", "Jumlah penerima lokal per broadcast.", &snap->fanout,
+                    fanout_bounds, sizeof(fanout_bounds) / sizeof(fanout_bounds[0]), 1.0);
+    write_histogram(out, "chat_delivery_seconds", "Waktu dari recv() pesan sampai writev() penerima terakhir.",
+                    &snap->delivery_ns, delivery_bounds, sizeof(delivery_bounds) / sizeof(delivery_bounds[0]), 1e-9);
+    write_histogram(out, "chat_out_queue_depth", "Panjang antrian kirim klien setelah frame masuk.", &snap->queue_depth,
+                    depth_bounds, sizeof(depth_bounds) / sizeof(depth_bounds[0]), 1.0);
+}
+
+static int write_all(int fd, const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t n = send(fd, data, length, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += n;
+        length -= (size_t)n;
+    }
+    return 0;
+}
+
+// Melayani satu pembaca. Permintaan "GET ..." (misalnya curl --unix-socket)
+// dijawab sebagai HTTP; pembaca lain (nc -U, socat) langsung mendapat teksnya.
+static void serve_scrape(int fd, struct metrics_snapshot *snap) {
+    struct timeval timeout = {SCRAPE_TIMEOUT_MS / 1000, (SCRAPE_TIMEOUT_MS % 1000) * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    char request[1024];
+    ssize_t request_len = 0;
+    struct pollfd pfd = {fd, POLLIN, 0};
+    if (poll(&pfd, 1, 100) > 0) {
+        request_len = recv(fd, request, sizeof(request), MSG_DONTWAIT);
+    }
+
+    char *body = NULL;
+    size_t body_len = 0;
+    FILE *out = open_memstream(&body, &body_len);
+    if (out == NULL) {
+        perror("open_memstream");
+        return;
+    }
+    collect(snap);
+    write_prometheus(out, snap);
+    fclose(out);
+
+    if (request_len >= 4 && memcmp(request, "GET ", 4) == 0) {
+        char header[256];
+        int header_len = snprintf(header, sizeof(header),
+                                  "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                                  "Content-Length: %zu\r\nConnection: close\r\n\r\n",
+                                  body_len);
+        if (write_all(fd, header, (size_t)header_len) < 0) {
+            free(body);
+            return;
+        }
+    }
+    write_all(fd, body, body_len);
+    free(body);
+}
+
+static double percentile_ms(const struct chat_histogram *hist, double percentile) {
+    return (double)chat_histogram_percentile(hist, percentile) / 1e6;
+}
+
+// Selisih histogram kumulatif terhadap ringkasan sebelumnya, agar persentil
+// di baris ringkasan hanya mencakup interval terakhir
+static void histogram_delta(struct chat_histogram *out, const struct chat_histogram *now, const struct chat_histogram *before) {
+    chat_histogram_reset(out);
+    for (size_t i = 0; i < CHAT_HISTOGRAM_BUCKETS; i++) {
+        out->buckets[i] = now->buckets[i] - before->buckets[i];
+    }
+    out->count = now->count - before->count;
+    out->sum = now->sum - before->sum;
+    out->max = now->max;
+}
+
+static void print_summary(struct metrics_snapshot *now, struct metrics_snapshot *before, double seconds) {
+    static struct chat_histogram fanout, delivery, depth;
+    histogram_delta(&fanout, &now->fanout, &before->fanout);
+    histogram_delta(&delivery, &now->delivery_ns, &before->delivery_ns);
+    histogram_delta(&depth, &now->queue_depth, &before->queue_depth);
+
+    printf("[METRIK] sesi %lu timeout %lu | accept %.1f/s ditolak %lu | masuk %.1f frame/s %.2f MB/s | keluar %.1f frame/s %.2f MB/s, "
+           "dibuang %lu | dibatasi %lu duplikat %lu | syscall %.1f/s | fanout p50 %llu p99 %llu | kirim p50 %.3f ms p99 %.3f ms p999 %.3f ms | "
+           "antrian p99 %llu | log backlog %lu dibuang %lu\n",
+           now->sessions,
+           now->timeouts - before->timeouts,
+           (now->accepted - before->accepted) / seconds,
+           now->rejected - before->rejected,
+           (now->frames_in - before->frames_in) / seconds,
+           (now->bytes_in - before->bytes_in) / seconds / 1e6,
+           (now->frames_out - before->frames_out) / seconds,
+           (now->bytes_out - before->bytes_out) / seconds / 1e6,
+           now->frames_dropped - before->frames_dropped,
+           now->throttled - before->throttled,
+           now->duplicates - before->duplicates,
+           (now->syscalls - before->syscalls) / seconds,
+           (unsigned long long)chat_histogram_percentile(&fanout, 50.0),
+           (unsigned long long)chat_histogram_percentile(&fanout, 99.0),
+           percentile_ms(&delivery, 50.0), percentile_ms(&delivery, 99.0), percentile_ms(&delivery, 99.9),
+           (unsigned long long)chat_histogram_percentile(&depth, 99.0),
+           now->log_backlog, now->log_dropped);
+    fflush(stdout);
+}
+
+static void *metrics_loop(void *arg) {
+    (void)arg;
+    // Dua snapshot bergantian: yang terbaru dan yang dipakai ringkasan sebelumnya
+    struct metrics_snapshot *current = malloc(sizeof(*current));
+    struct metrics_snapshot *previous = malloc(sizeof(*previous));
+    if (current == NULL || previous == NULL) {
+        perror("malloc");
+        free(current);
+        free(previous);
+        return NULL;
+    }
+    collect(previous);
+    uint64_t last_summary = metrics_now();
+    uint64_t interval_ns = (uint64_t)metrics_cfg.summary_interval * 1000000000ull;
+
+    while (1) {
+        int timeout = -1;
+        if (interval_ns > 0) {
+            uint64_t now = metrics_now();
+            uint64_t due = last_summary + interval_ns;
+            timeout = now >= due ? 0 : (int)((due - now) / 1000000) + 1;
+        }
+
+        struct pollfd pfds[2] = {{stop_fd, POLLIN, 0}, {listen_fd, POLLIN, 0}};
+        int ready = poll(pfds, listen_fd >= 0 ? 2 : 1, timeout);
+        if (ready < 0 && errno != EINTR) {
+            perror("poll");
+            break;
+        }
+        if (pfds[0].revents & POLLIN) {
+            break;
+        }
+        if (listen_fd >= 0 && (pfds[1].revents & POLLIN)) {
+            int client_fd;
+            while ((client_fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC)) >= 0) {
+                serve_scrape(client_fd, current);
+                close(client_fd);
+            }
+        }
+
+        uint64_t now = metrics_now();
+        if (interval_ns > 0 && now - last_summary >= interval_ns) {
+            collect(current);
+            print_summary(current, previous, (double)(now - last_summary) / 1e9);
+            struct metrics_snapshot *tmp = previous;
+            previous = current;
+            current = tmp;
+            last_summary = now;
+        }
+    }
+
+    free(current);
+    free(previous);
+    return NULL;
+}
+
+// Membuat socket Unix non-blocking untuk pembaca metrik
+static int create_metrics_socket(const char *path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "[ERROR] Path socket metrik terlalu panjang: %s\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("socket metrik");
+        return -1;
+    }
+    // Socket sisa server sebelumnya dihapus dulu
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 16) < 0) {
+        perror("[ERROR] Gagal membuka socket metrik");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int metrics_start(const struct metrics_config *config) {
+    metrics_cfg = *config;
+    if (metrics_cfg.socket_path == NULL && metrics_cfg.summary_interval <= 0) {
+        return 0;
+    }
+
+    if (metrics_cfg.socket_path != NULL) {
+        listen_fd = create_metrics_socket(metrics_cfg.socket_path);
+        if (listen_fd < 0) {
+            return -1;
+        }
+    }
+    stop_fd = eventfd(0, EFD_CLOEXEC);
+    if (stop_fd < 0) {
+        perror("eventfd");
+        return -1;
+    }
+    if (pthread_create(&metrics_thread, NULL, metrics_loop, NULL) != 0) {
+        perror("[ERROR] Gagal membuat thread metrik");
+        return -1;
+    }
+    running = 1;
+    return 0;
+}
+
+void metrics_stop(void) {
+    if (!running) {
+        return;
+    }
+    uint64_t one = 1;
+    if (write(stop_fd, &one, sizeof(one)) < 0) {
+        perror("eventfd write");
+    }
+    pthread_join(metrics_thread, NULL);
+    running = 0;
+    close(stop_fd);
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        unlink(metrics_cfg.socket_path);
+        listen_fd = -1;
+    }
+}
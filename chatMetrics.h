@@ -0,0 +1,60 @@
+#ifndef CHAT_METRICS_H
+#define CHAT_METRICS_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "chatHistogram.h"
+
+// Slot metrik milik satu shard. Setiap slot menempati cache line sendiri dan
+// hanya ditulis oleh thread pemiliknya, sehingga penambahan counter cukup
+// berupa load + store biasa tanpa instruksi atomik ber-lock. Thread metrik
+// menjumlahkan semua slot saat diminta.
+struct shard_metrics {
+    _Alignas(64) atomic_ulong accepted;
+    atomic_ulong rejected;        // koneksi yang ditolak admission control
+    atomic_ulong sessions;
+    atomic_ulong timeouts;        // sesi yang diputus karena timeout login, idle, atau antrian macet
+    atomic_ulong bytes_in;
+    atomic_ulong bytes_out;
+    atomic_ulong frames_in;
+    atomic_ulong frames_out;      // frame yang masuk ke antrian kirim klien
+    atomic_ulong frames_dropped;  // frame yang dibuang kebijakan slow consumer
+    atomic_ulong throttled;       // frame klien yang dibuang karena melewati batas laju
+    atomic_ulong duplicates;      // frame klien yang dibuang karena payload-nya duplikat
+    atomic_ulong broadcasts;
+    atomic_ulong syscalls;        // syscall I/O di event loop (recv, writev, epoll_wait, io_uring_enter, ...)
+
+    // Histogram tidak disinkronkan: pembaca bisa melihat data yang sedikit
+    // tertinggal, cukup untuk pemantauan dan tanpa biaya di jalur pesan.
+    struct chat_histogram fanout;       // penerima lokal per broadcast
+    struct chat_histogram delivery_ns;  // recv() sampai writev() penerima terakhir
+    struct chat_histogram queue_depth;  // panjang antrian klien setelah frame masuk
+};
+
+struct metrics_config {
+    const char *socket_path;  // socket Unix untuk format teks Prometheus (NULL = mati)
+    int summary_interval;     // detik antar baris ringkasan (0 = mati)
+};
+
+// Penambahan counter oleh thread pemilik slot
+static inline void metric_add(atomic_ulong *counter, unsigned long n) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+static inline void metric_set(atomic_ulong *gauge, unsigned long value) {
+    atomic_store_explicit(gauge, value, memory_order_relaxed);
+}
+
+// Waktu monoton dalam nanodetik untuk histogram latensi
+uint64_t metrics_now(void);
+
+// Menyiapkan satu slot per shard. Mengembalikan 0 jika berhasil.
+int metrics_init(int num_slots);
+struct shard_metrics *metrics_slot(int id);
+
+// Menjalankan thread metrik (socket Unix dan ringkasan periodik)
+int metrics_start(const struct metrics_config *config);
+void metrics_stop(void);
+
+#endif
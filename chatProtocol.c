@@ -0,0 +1,201 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "chatProtocol.h"
+
+// Ukuran awal buffer parser; diperbesar hanya saat ada frame yang lebih besar
+#define PARSER_INITIAL_CAPACITY 4096
+
+static uint32_t read_u32(const unsigned char *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+void chat_frame_header(void *out, uint8_t type, uint32_t length) {
+    unsigned char *h = out;
+    h[0] = CHAT_PROTOCOL_VERSION;
+    h[1] = type;
+    h[2] = 0;
+    h[3] = 0;
+    h[4] = (unsigned char)(length >> 24);
+    h[5] = (unsigned char)(length >> 16);
+    h[6] = (unsigned char)(length >> 8);
+    h[7] = (unsigned char)length;
+}
+
+int chat_parser_init(struct chat_parser *parser, size_t max_payload) {
+    parser->buffer = malloc(PARSER_INITIAL_CAPACITY);
+    if (parser->buffer == NULL) {
+        return -1;
+    }
+    parser->capacity = PARSER_INITIAL_CAPACITY;
+    parser->start = 0;
+    parser->end = 0;
+    parser->max_payload = max_payload;
+    return 0;
+}
+
+void chat_parser_free(struct chat_parser *parser) {
+    free(parser->buffer);
+    parser->buffer = NULL;
+    parser->capacity = 0;
+}
+
+char *chat_parser_write_ptr(struct chat_parser *parser, size_t *space) {
+    size_t pending = parser->end - parser->start;
+
+    // Frame yang sudah dikeluarkan tidak dipakai lagi; geser sisa frame parsial ke depan
+    if (parser->start > 0) {
+        if (pending > 0) {
+            memmove(parser->buffer, parser->buffer + parser->start, pending);
+        }
+        parser->start = 0;
+        parser->end = pending;
+    }
+
+    // Kecilkan lagi buffer yang sempat membesar untuk satu frame besar
+    if (pending == 0 && parser->capacity > PARSER_INITIAL_CAPACITY) {
+        char *smaller = realloc(parser->buffer, PARSER_INITIAL_CAPACITY);
+        if (smaller != NULL) {
+            parser->buffer = smaller;
+            parser->capacity = PARSER_INITIAL_CAPACITY;
+        }
+    }
+
+    // Pastikan frame parsial yang sedang ditunggu muat seluruhnya
+    if (pending >= CHAT_FRAME_HEADER_SIZE) {
+        uint32_t length = read_u32((unsigned char *)parser->buffer + 4);
+        size_t needed = CHAT_FRAME_HEADER_SIZE + (length <= parser->max_payload ? length : 0);
+        if (needed > parser->capacity) {
+            char *bigger = realloc(parser->buffer, needed);
+            if (bigger == NULL) {
+                return NULL;
+            }
+            parser->buffer = bigger;
+            parser->capacity = needed;
+        }
+    }
+
+    *space = parser->capacity - parser->end;
+    return parser->buffer + parser->end;
+}
+
+void chat_parser_commit(struct chat_parser *parser, size_t n) {
+    parser->end += n;
+}
+
+int chat_parser_next(struct chat_parser *parser, struct chat_frame *frame) {
+    size_t available = parser->end - parser->start;
+    if (available < CHAT_FRAME_HEADER_SIZE) {
+        return 0;
+    }
+
+    const unsigned char *h = (const unsigned char *)parser->buffer + parser->start;
+    if (h[0] != CHAT_PROTOCOL_VERSION) {
+        return -1;
+    }
+    uint32_t length = read_u32(h + 4);
+    if (length > parser->max_payload) {
+        return -1;
+    }
+    if (available < CHAT_FRAME_HEADER_SIZE + (size_t)length) {
+        return 0;
+    }
+
+    frame->version = h[0];
+    frame->type = h[1];
+    frame->flags = (uint16_t)((h[2] << 8) | h[3]);
+    frame->length = length;
+    frame->payload = parser->buffer + parser->start + CHAT_FRAME_HEADER_SIZE;
+    parser->start += CHAT_FRAME_HEADER_SIZE + length;
+    return 1;
+}
+
+int chat_read_field(const char *payload, size_t length, size_t *offset, const char **field) {
+    if (*offset >= length) {
+        return -1;
+    }
+    size_t field_len = (unsigned char)payload[*offset];
+    if (*offset + 1 + field_len > length) {
+        return -1;
+    }
+    *field = payload + *offset + 1;
+    *offset += 1 + field_len;
+    return (int)field_len;
+}
+
+size_t chat_retry_payload(void *out, size_t size, uint32_t retry_after_ms, const char *reason) {
+    size_t reason_len = strlen(reason);
+    if (4 + reason_len > size) {
+        return 0;
+    }
+    unsigned char *p = out;
+    p[0] = (unsigned char)(retry_after_ms >> 24);
+    p[1] = (unsigned char)(retry_after_ms >> 16);
+    p[2] = (unsigned char)(retry_after_ms >> 8);
+    p[3] = (unsigned char)retry_after_ms;
+    memcpy(p + 4, reason, reason_len);
+    return 4 + reason_len;
+}
+
+size_t chat_reject_frame(void *out, size_t size, uint32_t retry_after_ms, const char *reason) {
+    if (size < CHAT_FRAME_HEADER_SIZE) {
+        return 0;
+    }
+    unsigned char *p = out;
+    size_t length = chat_retry_payload(p + CHAT_FRAME_HEADER_SIZE, size - CHAT_FRAME_HEADER_SIZE, retry_after_ms, reason);
+    if (length == 0) {
+        return 0;
+    }
+    chat_frame_header(p, FRAME_REJECT, (uint32_t)length);
+    return CHAT_FRAME_HEADER_SIZE + length;
+}
+
+int chat_read_reject(const struct chat_frame *frame, uint32_t *retry_after_ms, const char **reason, size_t *reason_len) {
+    if (frame->length < 4) {
+        return -1;
+    }
+    *retry_after_ms = read_u32((const unsigned char *)frame->payload);
+    *reason = frame->payload + 4;
+    *reason_len = frame->length - 4;
+    return 0;
+}
+
+int chat_send_frame(int fd, uint8_t type, const void *payload, size_t length) {
+    unsigned char header[CHAT_FRAME_HEADER_SIZE];
+    chat_frame_header(header, type, (uint32_t)length);
+
+    struct iovec iov[2];
+    iov[0].iov_base = header;
+    iov[0].iov_len = sizeof(header);
+    iov[1].iov_base = (void *)payload;
+    iov[1].iov_len = length;
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+
+    // Ulangi sampai seluruh frame terkirim (send bisa menulis sebagian)
+    while (msg.msg_iovlen > 0) {
+        ssize_t n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        while (msg.msg_iovlen > 0 && (size_t)n >= msg.msg_iov->iov_len) {
+            n -= msg.msg_iov->iov_len;
+            msg.msg_iov++;
+            msg.msg_iovlen--;
+        }
+        if (n > 0) {
+            msg.msg_iov->iov_base = (char *)msg.msg_iov->iov_base + n;
+            msg.msg_iov->iov_len -= n;
+        }
+    }
+    return 0;
+}
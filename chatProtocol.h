@@ -0,0 +1,118 @@
+#ifndef CHAT_PROTOCOL_H
+#define CHAT_PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Format frame (semua angka dalam network byte order):
+//
+//   0        1        2                 4                                 8
+//   +--------+--------+-----------------+---------------------------------+
+//   | versi  |  tipe  |      flags      |          panjang payload        |
+//   +--------+--------+-----------------+---------------------------------+
+//   | payload (panjang byte) ...
+//
+// Payload per tipe:
+//   FRAME_LOGIN   klien -> server : username
+//   FRAME_CHAT    klien -> server : teks pesan (dikirim ke room aktif)
+//                 server -> klien : u8 panjang username | username |
+//                                   u8 panjang room | room | teks
+//   FRAME_CONTROL server -> klien : teks pemberitahuan dari server
+//   FRAME_JOIN    klien -> server : nama room (sekaligus menjadi room aktif)
+//   FRAME_LEAVE   klien -> server : nama room
+//   FRAME_LIST    klien -> server : kosong; dibalas FRAME_CONTROL berisi daftar room
+//   FRAME_DIRECT  klien -> server : u8 panjang username tujuan | username | teks
+//                 server -> klien : u8 panjang username pengirim | username | teks
+//   FRAME_REJECT  server -> klien : u32 saran waktu tunggu (ms) | alasan; dikirim
+//                                   saat koneksi baru ditolak, lalu koneksi ditutup
+//   FRAME_PING    dua arah        : data bebas (maks CHAT_PING_MAX); penerima
+//                                   wajib membalas FRAME_PONG dengan data yang sama
+//   FRAME_PONG    dua arah        : salinan data FRAME_PING
+//   FRAME_THROTTLE server -> klien : payload sama dengan FRAME_REJECT; frame klien
+//                                    dibuang karena melewati batas laju atau
+//                                    duplikat, koneksi tetap terbuka
+//
+// Flags:
+//   CHAT_FLAG_HISTORY  frame CHAT adalah riwayat room dari journal, bukan pesan baru
+
+#define CHAT_PROTOCOL_VERSION 2
+#define CHAT_FRAME_HEADER_SIZE 8
+#define CHAT_DEFAULT_MAX_PAYLOAD (64 * 1024)
+#define CHAT_USERNAME_MAX 64
+#define CHAT_ROOM_MAX 64
+#define CHAT_DEFAULT_ROOM "lobby"
+#define CHAT_PING_MAX 64
+
+#define CHAT_FLAG_HISTORY 0x0001
+
+enum chat_frame_type {
+    FRAME_LOGIN = 1,
+    FRAME_CHAT = 2,
+    FRAME_CONTROL = 3,
+    FRAME_JOIN = 4,
+    FRAME_LEAVE = 5,
+    FRAME_LIST = 6,
+    FRAME_DIRECT = 7,
+    FRAME_REJECT = 8,
+    FRAME_PING = 9,
+    FRAME_PONG = 10,
+    FRAME_THROTTLE = 11
+};
+
+struct chat_frame {
+    uint8_t version;
+    uint8_t type;
+    uint16_t flags;
+    uint32_t length;
+    // Menunjuk langsung ke buffer parser (tanpa salinan). Hanya valid sampai
+    // chat_parser_write_ptr() dipanggil lagi.
+    const char *payload;
+};
+
+// Parser bertahap: menerima potongan stream TCP sembarang dan mengeluarkan
+// frame utuh satu per satu, termasuk banyak frame dari satu kali recv().
+struct chat_parser {
+    char *buffer;
+    size_t capacity;
+    size_t start;
+    size_t end;
+    size_t max_payload;
+};
+
+// Menulis header frame ke out (CHAT_FRAME_HEADER_SIZE byte)
+void chat_frame_header(void *out, uint8_t type, uint32_t length);
+
+int chat_parser_init(struct chat_parser *parser, size_t max_payload);
+void chat_parser_free(struct chat_parser *parser);
+
+// Mengembalikan area kosong untuk recv() berikutnya beserta ukurannya.
+// Buffer dipadatkan atau diperbesar seperlunya. NULL jika alokasi gagal.
+char *chat_parser_write_ptr(struct chat_parser *parser, size_t *space);
+
+// Menandai n byte hasil recv() sebagai data yang siap diparse
+void chat_parser_commit(struct chat_parser *parser, size_t n);
+
+// 1 = frame utuh tersedia, 0 = butuh data lagi, -1 = versi tidak dikenal
+// atau payload melebihi batas maksimum.
+int chat_parser_next(struct chat_parser *parser, struct chat_frame *frame);
+
+// Membaca field berawalan panjang 1 byte dari payload mulai *offset. Mengembalikan
+// panjang field (pointer di *field) atau -1 jika payload terlalu pendek.
+int chat_read_field(const char *payload, size_t length, size_t *offset, const char **field);
+
+// Menulis frame REJECT utuh ke out. Mengembalikan panjang frame, atau 0 jika
+// out terlalu kecil.
+size_t chat_reject_frame(void *out, size_t size, uint32_t retry_after_ms, const char *reason);
+
+// Menulis payload REJECT/THROTTLE (tanpa header) ke out. Mengembalikan panjang
+// payload, atau 0 jika out terlalu kecil.
+size_t chat_retry_payload(void *out, size_t size, uint32_t retry_after_ms, const char *reason);
+
+// Membaca payload frame REJECT atau THROTTLE. 0 jika berhasil, -1 jika payload
+// terlalu pendek.
+int chat_read_reject(const struct chat_frame *frame, uint32_t *retry_after_ms, const char **reason, size_t *reason_len);
+
+// Mengirim satu frame utuh pada socket blocking. 0 jika berhasil, -1 jika gagal.
+int chat_send_frame(int fd, uint8_t type, const void *payload, size_t length);
+
+#endif
@@ -0,0 +1,193 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "chatProtocol.h"
+#include "chatQueue.h"
+
+// Jumlah frame maksimum per panggilan sendmsg()
+#define FLUSH_IOV_MAX 64
+
+struct chat_buffer *chat_buffer_alloc(size_t length) {
+    struct chat_buffer *buf = malloc(sizeof(*buf) + length);
+    if (buf == NULL) {
+        return NULL;
+    }
+    atomic_init(&buf->refcount, 1);
+    buf->length = length;
+    buf->data = (char *)(buf + 1);
+    buf->release_owner = NULL;
+    buf->owner = NULL;
+    return buf;
+}
+
+struct chat_buffer *chat_buffer_external(const char *data, size_t length, void (*release_owner)(void *owner), void *owner) {
+    struct chat_buffer *buf = malloc(sizeof(*buf));
+    if (buf == NULL) {
+        return NULL;
+    }
+    atomic_init(&buf->refcount, 1);
+    buf->length = length;
+    buf->data = (char *)data;
+    buf->release_owner = release_owner;
+    buf->owner = owner;
+    return buf;
+}
+
+void chat_buffer_retain(struct chat_buffer *buf) {
+    atomic_fetch_add_explicit(&buf->refcount, 1, memory_order_relaxed);
+}
+
+void chat_buffer_release(struct chat_buffer *buf) {
+    if (atomic_fetch_sub_explicit(&buf->refcount, 1, memory_order_acq_rel) == 1) {
+        if (buf->release_owner != NULL) {
+            buf->release_owner(buf->owner);
+        }
+        free(buf);
+    }
+}
+
+struct chat_buffer *chat_buffer_frame(unsigned char type, const void *payload, size_t length) {
+    struct chat_buffer *buf = chat_buffer_alloc(CHAT_FRAME_HEADER_SIZE + length);
+    if (buf == NULL) {
+        return NULL;
+    }
+    chat_frame_header(buf->data, type, (uint32_t)length);
+    memcpy(buf->data + CHAT_FRAME_HEADER_SIZE, payload, length);
+    return buf;
+}
+
+int out_queue_init(struct out_queue *queue, unsigned int capacity) {
+    unsigned int size = 2;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    queue->items = malloc(size * sizeof(*queue->items));
+    if (queue->items == NULL) {
+        return -1;
+    }
+    queue->head = 0;
+    queue->count = 0;
+    queue->capacity = size;
+    queue->head_offset = 0;
+    queue->bytes = 0;
+    queue->inflight = 0;
+    return 0;
+}
+
+void out_queue_free(struct out_queue *queue) {
+    for (unsigned int i = 0; i < queue->count; i++) {
+        chat_buffer_release(queue->items[(queue->head + i) & (queue->capacity - 1)]);
+    }
+    free(queue->items);
+    queue->items = NULL;
+    queue->count = 0;
+    queue->bytes = 0;
+}
+
+void out_queue_push(struct out_queue *queue, struct chat_buffer *buf) {
+    chat_buffer_retain(buf);
+    queue->items[(queue->head + queue->count) & (queue->capacity - 1)] = buf;
+    queue->count++;
+    queue->bytes += buf->length;
+}
+
+int out_queue_drop_oldest(struct out_queue *queue) {
+    unsigned int mask = queue->capacity - 1;
+    // Frame terdepan yang sudah terkirim sebagian atau sedang dikirim secara
+    // asinkron harus diselesaikan agar stream tetap utuh
+    unsigned int pinned = queue->inflight > 0 ? queue->inflight : (queue->head_offset > 0 ? 1 : 0);
+    if (queue->count <= pinned) {
+        return 0;
+    }
+
+    // Buang frame pertama yang belum dikirim dengan menggeser frame yang
+    // tertahan satu posisi ke belakang
+    unsigned int victim = (queue->head + pinned) & mask;
+    struct chat_buffer *buf = queue->items[victim];
+    for (unsigned int i = pinned; i > 0; i--) {
+        queue->items[(queue->head + i) & mask] = queue->items[(queue->head + i - 1) & mask];
+    }
+    queue->head = (queue->head + 1) & mask;
+    queue->count--;
+    queue->bytes -= buf->length;
+    chat_buffer_release(buf);
+    return 1;
+}
+
+unsigned int out_queue_drop_unsent(struct out_queue *queue) {
+    unsigned int dropped = 0;
+    while (out_queue_drop_oldest(queue)) {
+        dropped++;
+    }
+    return dropped;
+}
+
+unsigned int out_queue_fill_iov(struct out_queue *queue, struct iovec *iov, struct chat_buffer **bufs, unsigned int max) {
+    unsigned int mask = queue->capacity - 1;
+    unsigned int n = queue->count < max ? queue->count : max;
+    for (unsigned int i = 0; i < n; i++) {
+        struct chat_buffer *buf = queue->items[(queue->head + i) & mask];
+        iov[i].iov_base = buf->data;
+        iov[i].iov_len = buf->length;
+        if (bufs != NULL) {
+            bufs[i] = buf;
+        }
+    }
+    if (n > 0) {
+        iov[0].iov_base = (char *)iov[0].iov_base + queue->head_offset;
+        iov[0].iov_len -= queue->head_offset;
+    }
+    return n;
+}
+
+void out_queue_consume(struct out_queue *queue, size_t written) {
+    unsigned int mask = queue->capacity - 1;
+    queue->bytes -= written;
+
+    // Lepas frame yang sudah terkirim penuh
+    size_t remaining = written + queue->head_offset;
+    while (queue->count > 0) {
+        struct chat_buffer *buf = queue->items[queue->head];
+        if (remaining < buf->length) {
+            break;
+        }
+        remaining -= buf->length;
+        queue->head = (queue->head + 1) & mask;
+        queue->count--;
+        chat_buffer_release(buf);
+    }
+    queue->head_offset = remaining;
+}
+
+int out_queue_flush(struct out_queue *queue, int fd, unsigned long *writes) {
+    while (queue->count > 0) {
+        struct iovec iov[FLUSH_IOV_MAX];
+        unsigned int n = out_queue_fill_iov(queue, iov, NULL, FLUSH_IOV_MAX);
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = n;
+        ssize_t written = sendmsg(fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+        (*writes)++;
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return 0;
+            }
+            return -1;
+        }
+        out_queue_consume(queue, (size_t)written);
+
+        if (queue->head_offset > 0) {
+            return 0; // Kernel hanya menerima sebagian: socket penuh
+        }
+    }
+    return 1;
+}
@@ -0,0 +1,72 @@
+#ifndef CHAT_QUEUE_H
+#define CHAT_QUEUE_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+#include <sys/uio.h>
+
+// Frame keluar yang sudah di-encode. Satu buffer dipakai bersama oleh semua
+// penerima (dan semua shard); setiap antrian klien hanya menyimpan pointer.
+// data menunjuk ke memori tepat setelah struct ini, atau ke memori milik
+// pihak lain (misalnya halaman journal yang di-mmap) yang dilepas lewat
+// release_owner saat referensi terakhir hilang.
+struct chat_buffer {
+    atomic_int refcount;
+    size_t length;
+    char *data;
+    void (*release_owner)(void *owner);
+    void *owner;
+};
+
+// Alokasi buffer dengan refcount awal 1
+struct chat_buffer *chat_buffer_alloc(size_t length);
+
+// Buffer yang menunjuk ke memori luar tanpa menyalin isinya (refcount awal 1)
+struct chat_buffer *chat_buffer_external(const char *data, size_t length, void (*release_owner)(void *owner), void *owner);
+void chat_buffer_retain(struct chat_buffer *buf);
+void chat_buffer_release(struct chat_buffer *buf);
+
+// Membuat frame utuh (header + payload) dalam satu buffer
+struct chat_buffer *chat_buffer_frame(unsigned char type, const void *payload, size_t length);
+
+// Antrian kirim per klien: ring berisi pointer ke chat_buffer
+struct out_queue {
+    struct chat_buffer **items;
+    unsigned int head;
+    unsigned int count;
+    unsigned int capacity;
+    size_t head_offset; // Byte frame terdepan yang sudah terkirim
+    size_t bytes;       // Total byte yang belum terkirim
+    unsigned int inflight; // Frame terdepan yang sedang dikirim secara asinkron (io_uring)
+};
+
+// Kapasitas dibulatkan ke pangkat dua (minimal 2). 0 jika berhasil.
+int out_queue_init(struct out_queue *queue, unsigned int capacity);
+void out_queue_free(struct out_queue *queue);
+
+// Menambah frame ke ekor antrian (mengambil satu referensi). Pemanggil
+// memastikan antrian belum penuh.
+void out_queue_push(struct out_queue *queue, struct chat_buffer *buf);
+
+// Membuang frame tertua yang belum mulai dikirim (frame yang terkirim sebagian
+// atau masih in-flight tidak disentuh). 1 jika ada yang dibuang.
+int out_queue_drop_oldest(struct out_queue *queue);
+
+// Membuang semua frame yang belum mulai dikirim; mengembalikan jumlahnya
+unsigned int out_queue_drop_unsent(struct out_queue *queue);
+
+// Mengisi iov dengan frame terdepan (maksimal max), dimulai dari byte yang
+// belum terkirim. Jika bufs tidak NULL, buffer frame-nya juga dicatat (tanpa
+// menambah referensi). Mengembalikan jumlah iov yang terisi.
+unsigned int out_queue_fill_iov(struct out_queue *queue, struct iovec *iov, struct chat_buffer **bufs, unsigned int max);
+
+// Mencatat written byte dari depan antrian sebagai terkirim dan melepas
+// frame yang sudah terkirim penuh
+void out_queue_consume(struct out_queue *queue, size_t written);
+
+// Mengirim isi antrian dengan sendmsg(MSG_DONTWAIT), jadi tidak pernah
+// menunggu walaupun socket blocking. 1 = antrian kosong, 0 = socket penuh
+// (tunggu EPOLLOUT), -1 = error pada socket. writes ditambah jumlah syscall.
+int out_queue_flush(struct out_queue *queue, int fd, unsigned long *writes);
+
+#endif
@@ -0,0 +1,115 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chatRing.h"
+
+// Header setiap slot: nomor urut yang menandai slot siap ditulis atau dibaca
+struct chat_ring_slot {
+    atomic_size_t sequence;
+    _Alignas(16) unsigned char data[];
+};
+
+static struct chat_ring_slot *slot_at(struct chat_ring *ring, size_t pos) {
+    return (struct chat_ring_slot *)(ring->slots + (pos & ring->mask) * ring->stride);
+}
+
+int chat_ring_init(struct chat_ring *ring, size_t capacity, size_t elem_size) {
+    size_t size = 2;
+    while (size < capacity) {
+        size <<= 1;
+    }
+
+    ring->mask = size - 1;
+    ring->elem_size = elem_size;
+    // Ukuran slot dibulatkan ke 16 byte agar data di dalamnya tetap teralign
+    ring->stride = (sizeof(struct chat_ring_slot) + elem_size + 15) & ~(size_t)15;
+    ring->slots = aligned_alloc(64, (size * ring->stride + 63) & ~(size_t)63);
+    if (ring->slots == NULL) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < size; i++) {
+        atomic_init(&slot_at(ring, i)->sequence, i);
+    }
+    atomic_init(&ring->enqueue_pos, 0);
+    atomic_init(&ring->dequeue_pos, 0);
+    return 0;
+}
+
+void chat_ring_destroy(struct chat_ring *ring) {
+    free(ring->slots);
+    ring->slots = NULL;
+}
+
+void *chat_ring_claim(struct chat_ring *ring, size_t *pos_out) {
+    struct chat_ring_slot *slot;
+    size_t pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+
+    while (1) {
+        slot = slot_at(ring, pos);
+        size_t seq = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            // Slot kosong: klaim posisi ini
+            if (atomic_compare_exchange_weak_explicit(&ring->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return NULL; // Antrian penuh
+        } else {
+            pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    *pos_out = pos;
+    return slot->data;
+}
+
+void chat_ring_publish(struct chat_ring *ring, size_t pos) {
+    atomic_store_explicit(&slot_at(ring, pos)->sequence, pos + 1, memory_order_release);
+}
+
+int chat_ring_push(struct chat_ring *ring, const void *elem) {
+    size_t pos;
+    void *data = chat_ring_claim(ring, &pos);
+    if (data == NULL) {
+        return 0;
+    }
+    memcpy(data, elem, ring->elem_size);
+    chat_ring_publish(ring, pos);
+    return 1;
+}
+
+void *chat_ring_peek(struct chat_ring *ring) {
+    size_t pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+    struct chat_ring_slot *slot = slot_at(ring, pos);
+    size_t seq = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+    if (seq != pos + 1) {
+        return NULL; // Kosong, atau produsen belum selesai menulis slot ini
+    }
+    return slot->data;
+}
+
+void chat_ring_consume(struct chat_ring *ring) {
+    size_t pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+    atomic_store_explicit(&ring->dequeue_pos, pos + 1, memory_order_relaxed);
+    atomic_store_explicit(&slot_at(ring, pos)->sequence, pos + ring->mask + 1, memory_order_release);
+}
+
+int chat_ring_pop(struct chat_ring *ring, void *out) {
+    void *data = chat_ring_peek(ring);
+    if (data == NULL) {
+        return 0;
+    }
+    memcpy(out, data, ring->elem_size);
+    chat_ring_consume(ring);
+    return 1;
+}
+
+size_t chat_ring_count(struct chat_ring *ring) {
+    size_t tail = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+    return tail > head ? tail - head : 0;
+}
@@ -0,0 +1,44 @@
+#ifndef CHAT_RING_H
+#define CHAT_RING_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+// Antrian melingkar berukuran tetap, lock-free untuk banyak produsen dan satu
+// konsumen (MPSC). Setiap slot menyimpan salinan elemen berukuran elem_size.
+// Algoritma: bounded queue berbasis nomor urut per slot (Vyukov).
+struct chat_ring {
+    size_t mask;
+    size_t elem_size;
+    size_t stride;
+    unsigned char *slots;
+    // Dipisah ke cache line berbeda agar produsen dan konsumen tidak saling ganggu
+    _Alignas(64) atomic_size_t enqueue_pos;
+    _Alignas(64) atomic_size_t dequeue_pos;
+};
+
+// Kapasitas dibulatkan ke pangkat dua. Mengembalikan 0 jika berhasil, -1 jika gagal.
+int chat_ring_init(struct chat_ring *ring, size_t capacity, size_t elem_size);
+void chat_ring_destroy(struct chat_ring *ring);
+
+// Aman dipanggil dari banyak thread. Mengembalikan 1 jika berhasil, 0 jika penuh.
+int chat_ring_push(struct chat_ring *ring, const void *elem);
+
+// Hanya boleh dipanggil oleh satu thread konsumen. Mengembalikan 1 jika ada
+// elemen yang diambil, 0 jika kosong.
+int chat_ring_pop(struct chat_ring *ring, void *out);
+
+// Varian tanpa salinan ganda: produsen mengklaim slot, menulis langsung ke
+// dalamnya, lalu mempublikasikannya. Mengembalikan NULL jika antrian penuh.
+void *chat_ring_claim(struct chat_ring *ring, size_t *pos);
+void chat_ring_publish(struct chat_ring *ring, size_t pos);
+
+// Konsumen membaca elemen terdepan langsung dari slot (NULL jika kosong),
+// lalu melepasnya dengan chat_ring_consume() setelah selesai dipakai.
+void *chat_ring_peek(struct chat_ring *ring);
+void chat_ring_consume(struct chat_ring *ring);
+
+// Perkiraan jumlah elemen dalam antrian (tidak eksak saat ada penulis aktif)
+size_t chat_ring_count(struct chat_ring *ring);
+
+#endif
@@ -0,0 +1,286 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "chatRoom.h"
+
+#define ROOM_TABLE_INITIAL_CAPACITY 64
+
+// Direktori global memakai struktur tabel yang sama; count berisi total
+// anggota di semua shard, shards berisi shard yang punya anggota, refs berisi
+// jumlah room lokal yang menunjuk entri tersebut, dan vektor members tidak
+// dipakai. Entri hidup selama masih ada room lokal yang menunjuknya, jadi
+// shard boleh membaca shards lewat room->entry tanpa lock.
+static struct room_table directory;
+static pthread_mutex_t directory_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static size_t table_probe(struct room_table *table, const char *name, size_t len, uint32_t hash) {
+    size_t mask = table->capacity - 1;
+    size_t i = hash & mask;
+    while (table->slots[i] != NULL) {
+        struct room *r = table->slots[i];
+        if (r->hash == hash && r->len == len && memcmp(r->name, name, len) == 0) {
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static int table_grow(struct room_table *table) {
+    size_t old_capacity = table->capacity;
+    struct room **old_slots = table->slots;
+    size_t capacity = old_capacity > 0 ? old_capacity * 2 : ROOM_TABLE_INITIAL_CAPACITY;
+
+    struct room **slots = calloc(capacity, sizeof(*slots));
+    if (slots == NULL) {
+        return -1;
+    }
+    table->slots = slots;
+    table->capacity = capacity;
+    for (size_t i = 0; i < old_capacity; i++) {
+        struct room *r = old_slots[i];
+        if (r != NULL) {
+            table->slots[table_probe(table, r->name, r->len, r->hash)] = r;
+        }
+    }
+    free(old_slots);
+    return 0;
+}
+
+static struct room *table_get_or_create(struct room_table *table, const char *name, size_t len) {
+    if ((table->count + 1) * 4 > table->capacity * 3 && table_grow(table) < 0) {
+        return NULL;
+    }
+    uint32_t hash = chat_hash_name(name, len);
+    size_t i = table_probe(table, name, len, hash);
+    if (table->slots[i] != NULL) {
+        return table->slots[i];
+    }
+
+    struct room *r = calloc(1, sizeof(*r));
+    if (r == NULL) {
+        return NULL;
+    }
+    r->hash = hash;
+    r->len = (unsigned char)len;
+    memcpy(r->name, name, len);
+    r->name[len] = '\0';
+    table->slots[i] = r;
+    table->count++;
+    return r;
+}
+
+// Menghapus room dari tabel dengan backward shift (tanpa tombstone)
+static void table_delete(struct room_table *table, struct room *room) {
+    size_t mask = table->capacity - 1;
+    size_t i = table_probe(table, room->name, room->len, room->hash);
+    table->slots[i] = NULL;
+    table->count--;
+
+    size_t j = (i + 1) & mask;
+    while (table->slots[j] != NULL) {
+        size_t home = table->slots[j]->hash & mask;
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            table->slots[i] = table->slots[j];
+            table->slots[j] = NULL;
+            i = j;
+        }
+        j = (j + 1) & mask;
+    }
+    free(room->members);
+    free(room);
+}
+
+// Mengambil entri direktori untuk room lokal yang baru dibuat
+static struct room *directory_acquire(const char *name, size_t len) {
+    pthread_mutex_lock(&directory_lock);
+    struct room *entry = NULL;
+    if (directory.capacity > 0 || table_grow(&directory) == 0) {
+        entry = table_get_or_create(&directory, name, len);
+        if (entry != NULL) {
+            entry->refs++;
+        }
+    }
+    pthread_mutex_unlock(&directory_lock);
+    return entry;
+}
+
+// Melepas entri direktori saat room lokal yang menunjuknya dihapus
+static void directory_release(struct room *entry) {
+    pthread_mutex_lock(&directory_lock);
+    if (--entry->refs == 0) {
+        table_delete(&directory, entry);
+    }
+    pthread_mutex_unlock(&directory_lock);
+}
+
+// Mencatat anggota yang masuk (delta 1) atau keluar (delta -1) di shard ini;
+// present menandai apakah shard ini masih punya anggota room tersebut
+static void directory_update(struct room *entry, int shard, int delta, int present) {
+    pthread_mutex_lock(&directory_lock);
+    entry->count += delta;
+    shard_mask_set(&entry->shards, shard, present);
+    pthread_mutex_unlock(&directory_lock);
+}
+
+// Menghapus room lokal beserta referensinya ke direktori
+static void room_delete(struct room_table *table, struct room *room) {
+    struct room *entry = room->entry;
+    table_delete(table, room);
+    if (entry != NULL) {
+        directory_release(entry);
+    }
+}
+
+int room_table_init(struct room_table *table, int shard) {
+    memset(table, 0, sizeof(*table));
+    table->shard = shard;
+    return table_grow(table);
+}
+
+void room_table_free(struct room_table *table) {
+    for (size_t i = 0; i < table->capacity; i++) {
+        if (table->slots[i] != NULL) {
+            if (table->slots[i]->entry != NULL) {
+                directory_release(table->slots[i]->entry);
+            }
+            free(table->slots[i]->members);
+            free(table->slots[i]);
+        }
+    }
+    free(table->slots);
+    memset(table, 0, sizeof(*table));
+}
+
+struct room *room_find(struct room_table *table, const char *name, size_t len) {
+    if (len == 0 || len > CHAT_ROOM_MAX) {
+        return NULL;
+    }
+    return table->slots[table_probe(table, name, len, chat_hash_name(name, len))];
+}
+
+int room_join(struct room_table *table, struct session *session, const char *name, size_t len, struct room **joined) {
+    struct room *room = room_find(table, name, len);
+    if (room != NULL) {
+        for (unsigned int i = 0; i < session->room_count; i++) {
+            if (session->rooms[i] == room) {
+                session->active_room = room;
+                *joined = room;
+                return 1;
+            }
+        }
+    }
+    if (session->room_count >= SESSION_MAX_ROOMS) {
+        return -2;
+    }
+
+    if (session->room_count == session->room_capacity) {
+        unsigned int capacity = session->room_capacity > 0 ? session->room_capacity * 2 : 4;
+        struct room **grown = realloc(session->rooms, capacity * sizeof(*grown));
+        if (grown == NULL) {
+            return -1;
+        }
+        session->rooms = grown;
+        session->room_capacity = (unsigned char)capacity;
+    }
+
+    if (room == NULL) {
+        room = table_get_or_create(table, name, len);
+        if (room == NULL) {
+            return -1;
+        }
+        room->entry = directory_acquire(room->name, room->len);
+        if (room->entry == NULL) {
+            table_delete(table, room);
+            return -1;
+        }
+    }
+    if (room->count == room->capacity) {
+        size_t capacity = room->capacity > 0 ? room->capacity * 2 : 8;
+        int *grown = realloc(room->members, capacity * sizeof(*grown));
+        if (grown == NULL) {
+            if (room->count == 0) {
+                room_delete(table, room);
+            }
+            return -1;
+        }
+        room->members = grown;
+        room->capacity = capacity;
+    }
+
+    room->members[room->count++] = session->fd;
+    session->rooms[session->room_count++] = room;
+    session->active_room = room;
+    directory_update(room->entry, table->shard, 1, 1);
+    *joined = room;
+    return 0;
+}
+
+int room_leave(struct room_table *table, struct session *session, struct room *room) {
+    unsigned int i;
+    for (i = 0; i < session->room_count; i++) {
+        if (session->rooms[i] == room) {
+            break;
+        }
+    }
+    if (i == session->room_count) {
+        return -1;
+    }
+    session->rooms[i] = session->rooms[--session->room_count];
+    if (session->active_room == room) {
+        session->active_room = session->room_count > 0 ? session->rooms[0] : NULL;
+    }
+
+    // Keluarkan fd dari vektor anggota dengan memindahkan anggota terakhir
+    for (size_t m = 0; m < room->count; m++) {
+        if (room->members[m] == session->fd) {
+            room->members[m] = room->members[--room->count];
+            break;
+        }
+    }
+    directory_update(room->entry, table->shard, -1, room->count > 0);
+    room_release(table, room);
+    return 0;
+}
+
+void room_leave_all(struct room_table *table, struct session *session) {
+    while (session->room_count > 0) {
+        room_leave(table, session, session->rooms[session->room_count - 1]);
+    }
+}
+
+void room_release(struct room_table *table, struct room *room) {
+    if (room->count == 0 && !room->busy) {
+        room_delete(table, room);
+    }
+}
+
+size_t room_directory_list(char *out, size_t cap) {
+    size_t used = 0;
+    int n = snprintf(out, cap, "Daftar room:");
+    if (n > 0) {
+        used = (size_t)n < cap ? (size_t)n : cap - 1;
+    }
+
+    pthread_mutex_lock(&directory_lock);
+    for (size_t i = 0; i < directory.capacity && used < cap; i++) {
+        struct room *entry = directory.slots[i];
+        // Entri tanpa anggota masih ditahan room lokal yang sedang di-broadcast
+        if (entry != NULL && entry->count > 0) {
+            n = snprintf(out + used, cap - used, " #%s (%zu)", entry->name, entry->count);
+            if (n < 0 || (size_t)n >= cap - used) {
+                used = cap - 1;
+                break;
+            }
+            used += n;
+        }
+    }
+    pthread_mutex_unlock(&directory_lock);
+    return used;
+}
+
+void room_shards(const struct room *room, struct shard_mask *shards) {
+    shard_mask_copy(shards, &room->entry->shards);
+}
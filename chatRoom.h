@@ -0,0 +1,65 @@
+#ifndef CHAT_ROOM_H
+#define CHAT_ROOM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "chatProtocol.h"
+#include "chatSession.h"
+
+// Jumlah room maksimum yang bisa diikuti satu sesi
+#define SESSION_MAX_ROOMS 32
+
+// Room di satu shard: vektor padat berisi fd anggota lokal, sehingga pesan
+// room hanya melewati anggotanya saja.
+struct room {
+    uint32_t hash;
+    unsigned char len;
+    unsigned char busy; // Sedang di-broadcast; penghapusan room ditunda
+    char name[CHAT_ROOM_MAX + 1];
+    int *members;
+    size_t count;
+    size_t capacity;
+    struct room *entry;  // Entri direktori global room ini (hanya room lokal)
+    // Hanya untuk entri direktori: shard yang punya anggota room ini dan jumlah
+    // room lokal yang menunjuk entri ini
+    struct shard_mask shards;
+    unsigned int refs;
+};
+
+// Hash table open addressing nama room -> room
+struct room_table {
+    struct room **slots;
+    size_t capacity;
+    size_t count;
+    int shard;  // id shard pemilik, untuk direktori global
+};
+
+int room_table_init(struct room_table *table, int shard);
+void room_table_free(struct room_table *table);
+
+struct room *room_find(struct room_table *table, const char *name, size_t len);
+
+// Memasukkan sesi ke room (room dibuat jika belum ada) dan menjadikannya room
+// aktif. 0 = bergabung, 1 = sudah anggota, -1 = gagal alokasi, -2 = terlalu
+// banyak room.
+int room_join(struct room_table *table, struct session *session, const char *name, size_t len, struct room **joined);
+
+// Mengeluarkan sesi dari room. -1 jika sesi bukan anggota room tersebut.
+int room_leave(struct room_table *table, struct session *session, struct room *room);
+
+// Mengeluarkan sesi dari semua room (dipakai saat koneksi ditutup)
+void room_leave_all(struct room_table *table, struct session *session);
+
+// Menghapus room yang kosong setelah broadcast selesai (busy kembali 0)
+void room_release(struct room_table *table, struct room *room);
+
+// Direktori global (semua shard) untuk daftar room, jumlah anggotanya, dan
+// shard yang punya anggota. Lock-nya hanya diambil saat join/leave/list.
+size_t room_directory_list(char *out, size_t cap);
+
+// Shard yang punya anggota room ini, dibaca tanpa lock di jalur pesan agar
+// pesan room hanya diteruskan ke shard yang membutuhkannya
+void room_shards(const struct room *room, struct shard_mask *shards);
+
+#endif
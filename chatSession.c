@@ -0,0 +1,314 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chatSession.h"
+
+#define SESSION_INITIAL_CAPACITY 64
+#define USERNAME_INITIAL_CAPACITY 64
+
+// Direktori global username -> shard. Ditulis hanya saat satu nama muncul
+// pertama kali atau hilang terakhir kali di satu shard, dibaca saat pesan
+// langsung ditujukan ke pengguna di shard lain.
+static struct username_table directory;
+static pthread_rwlock_t directory_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+// FNV-1a 32-bit
+uint32_t chat_hash_name(const char *name, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)name[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static size_t username_probe(struct username_table *users, const char *name, size_t len, uint32_t hash) {
+    size_t mask = users->capacity - 1;
+    size_t i = hash & mask;
+    while (users->slots[i] != NULL) {
+        struct username *u = users->slots[i];
+        if (u->hash == hash && u->len == len && memcmp(u->name, name, len) == 0) {
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static int username_grow(struct username_table *users) {
+    size_t old_capacity = users->capacity;
+    struct username **old_slots = users->slots;
+
+    users->capacity = old_capacity * 2;
+    users->slots = calloc(users->capacity, sizeof(*users->slots));
+    if (users->slots == NULL) {
+        users->slots = old_slots;
+        users->capacity = old_capacity;
+        return -1;
+    }
+    for (size_t i = 0; i < old_capacity; i++) {
+        struct username *u = old_slots[i];
+        if (u != NULL) {
+            users->slots[username_probe(users, u->name, u->len, u->hash)] = u;
+        }
+    }
+    free(old_slots);
+    return 0;
+}
+
+// Mengambil username yang sudah di-intern atau membuat yang baru
+static struct username *username_intern(struct username_table *users, const char *name, size_t len) {
+    if ((users->count + 1) * 4 > users->capacity * 3 && username_grow(users) < 0) {
+        return NULL;
+    }
+
+    uint32_t hash = chat_hash_name(name, len);
+    size_t i = username_probe(users, name, len, hash);
+    if (users->slots[i] != NULL) {
+        users->slots[i]->refcount++;
+        return users->slots[i];
+    }
+
+    struct username *u = malloc(sizeof(*u) + len + 1);
+    if (u == NULL) {
+        return NULL;
+    }
+    u->hash = hash;
+    u->refcount = 1;
+    u->session_fd = -1;
+    for (int w = 0; w < CHAT_SHARD_MASK_WORDS; w++) {
+        atomic_init(&u->shards.words[w], 0);
+    }
+    u->len = (unsigned char)len;
+    memcpy(u->name, name, len);
+    u->name[len] = '\0';
+    users->slots[i] = u;
+    users->count++;
+    return u;
+}
+
+// Melepas satu referensi; username dihapus dari tabel saat tidak dipakai lagi.
+// Penghapusan memakai backward shift agar tidak perlu tombstone.
+static void username_release(struct username_table *users, struct username *u) {
+    if (--u->refcount > 0) {
+        return;
+    }
+
+    size_t mask = users->capacity - 1;
+    size_t i = username_probe(users, u->name, u->len, u->hash);
+    users->slots[i] = NULL;
+    users->count--;
+
+    size_t j = (i + 1) & mask;
+    while (users->slots[j] != NULL) {
+        size_t home = users->slots[j]->hash & mask;
+        // Entri di j boleh digeser ke i jika i berada di antara home dan j (siklik)
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            users->slots[i] = users->slots[j];
+            users->slots[j] = NULL;
+            i = j;
+        }
+        j = (j + 1) & mask;
+    }
+    free(u);
+}
+
+// Menandai shard punya (present = 1) atau tidak lagi punya sesi bernama name
+static void directory_update(const char *name, size_t len, int shard, int present) {
+    pthread_rwlock_wrlock(&directory_lock);
+    if (directory.capacity == 0) {
+        directory.slots = calloc(USERNAME_INITIAL_CAPACITY, sizeof(*directory.slots));
+        if (directory.slots == NULL) {
+            pthread_rwlock_unlock(&directory_lock);
+            return;
+        }
+        directory.capacity = USERNAME_INITIAL_CAPACITY;
+    }
+    if (present) {
+        struct username *u = username_intern(&directory, name, len);
+        if (u != NULL) {
+            shard_mask_set(&u->shards, shard, 1);
+        }
+    } else {
+        struct username *u = directory.slots[username_probe(&directory, name, len, chat_hash_name(name, len))];
+        if (u != NULL) {
+            shard_mask_set(&u->shards, shard, 0);
+            username_release(&directory, u);
+        }
+    }
+    pthread_rwlock_unlock(&directory_lock);
+}
+
+// Memasang sesi sebagai kepala daftar sesi bernama u
+static void username_link(struct session_table *table, struct session *session, struct username *u) {
+    session->user = u;
+    session->name_prev = -1;
+    session->name_next = u->session_fd;
+    if (u->session_fd >= 0) {
+        session_get(table, u->session_fd)->name_prev = session->fd;
+    }
+    u->session_fd = session->fd;
+}
+
+// Melepas sesi dari daftar sesi bernama sama dan melepas referensi username-nya
+static void username_unlink(struct session_table *table, struct session *session) {
+    struct username *u = session->user;
+    if (session->name_prev >= 0) {
+        session_get(table, session->name_prev)->name_next = session->name_next;
+    } else {
+        u->session_fd = session->name_next;
+    }
+    if (session->name_next >= 0) {
+        session_get(table, session->name_next)->name_prev = session->name_prev;
+    }
+    session->user = NULL;
+    if (u->refcount == 1) {
+        // Sesi terakhir dengan nama ini di shard ini
+        directory_update(u->name, u->len, table->shard, 0);
+    }
+    username_release(&table->users, u);
+}
+
+int session_table_init(struct session_table *table, int shard) {
+    memset(table, 0, sizeof(*table));
+    table->shard = shard;
+    table->sessions = malloc(SESSION_INITIAL_CAPACITY * sizeof(*table->sessions));
+    table->users.slots = calloc(USERNAME_INITIAL_CAPACITY, sizeof(*table->users.slots));
+    if (table->sessions == NULL || table->users.slots == NULL) {
+        free(table->sessions);
+        free(table->users.slots);
+        return -1;
+    }
+    table->capacity = SESSION_INITIAL_CAPACITY;
+    table->users.capacity = USERNAME_INITIAL_CAPACITY;
+    return 0;
+}
+
+void session_table_free(struct session_table *table) {
+    while (table->count > 0) {
+        session_remove(table, table->sessions[table->count - 1].fd);
+    }
+    free(table->sessions);
+    free(table->index_by_fd);
+    free(table->users.slots);
+    memset(table, 0, sizeof(*table));
+}
+
+struct session *session_add(struct session_table *table, int fd) {
+    if ((size_t)fd >= table->fd_capacity) {
+        size_t new_capacity = table->fd_capacity > 0 ? table->fd_capacity : 1024;
+        while (new_capacity <= (size_t)fd) {
+            new_capacity *= 2;
+        }
+        int *grown = realloc(table->index_by_fd, new_capacity * sizeof(*grown));
+        if (grown == NULL) {
+            return NULL;
+        }
+        for (size_t i = table->fd_capacity; i < new_capacity; i++) {
+            grown[i] = -1;
+        }
+        table->index_by_fd = grown;
+        table->fd_capacity = new_capacity;
+    }
+
+    if (table->count == table->capacity) {
+        struct session *grown = realloc(table->sessions, table->capacity * 2 * sizeof(*grown));
+        if (grown == NULL) {
+            return NULL;
+        }
+        table->sessions = grown;
+        table->capacity *= 2;
+    }
+
+    struct session *session = &table->sessions[table->count];
+    memset(session, 0, sizeof(*session));
+    session->fd = fd;
+    table->index_by_fd[fd] = (int)table->count;
+    table->count++;
+    return session;
+}
+
+struct session *session_get(struct session_table *table, int fd) {
+    if (fd < 0 || (size_t)fd >= table->fd_capacity || table->index_by_fd[fd] < 0) {
+        return NULL;
+    }
+    return &table->sessions[table->index_by_fd[fd]];
+}
+
+void session_remove(struct session_table *table, int fd) {
+    struct session *session = session_get(table, fd);
+    if (session == NULL) {
+        return;
+    }
+
+    chat_parser_free(&session->parser);
+    out_queue_free(&session->queue);
+    free(session->rooms);
+    if (session->user != NULL) {
+        username_unlink(table, session);
+    }
+
+    // Pindahkan sesi terakhir ke posisi yang kosong agar array tetap padat
+    int index = table->index_by_fd[fd];
+    size_t last = table->count - 1;
+    if ((size_t)index != last) {
+        table->sessions[index] = table->sessions[last];
+        table->index_by_fd[table->sessions[index].fd] = index;
+    }
+    table->index_by_fd[fd] = -1;
+    table->count--;
+}
+
+int session_set_username(struct session_table *table, struct session *session, const char *name, size_t len) {
+    if (len > CHAT_USERNAME_MAX) {
+        len = CHAT_USERNAME_MAX;
+    }
+    struct username *u = username_intern(&table->users, name, len);
+    if (u == NULL) {
+        return -1;
+    }
+    // Nama ini baru muncul di shard ini
+    int fresh = u->refcount == 1;
+    if (session->user != NULL) {
+        username_unlink(table, session);
+    }
+    if (fresh) {
+        directory_update(u->name, u->len, table->shard, 1);
+    }
+    username_link(table, session, u);
+    return 0;
+}
+
+struct session *session_find_user(struct session_table *table, const char *name, size_t len) {
+    if (len > CHAT_USERNAME_MAX) {
+        return NULL;
+    }
+    size_t i = username_probe(&table->users, name, len, chat_hash_name(name, len));
+    struct username *u = table->users.slots[i];
+    if (u == NULL || u->session_fd < 0) {
+        return NULL;
+    }
+    return session_get(table, u->session_fd);
+}
+
+int session_directory_find(const char *name, size_t len, struct shard_mask *shards) {
+    if (len > CHAT_USERNAME_MAX) {
+        return -1;
+    }
+    int rc = -1;
+    pthread_rwlock_rdlock(&directory_lock);
+    if (directory.capacity > 0) {
+        struct username *u = directory.slots[username_probe(&directory, name, len, chat_hash_name(name, len))];
+        if (u != NULL) {
+            shard_mask_copy(shards, &u->shards);
+            rc = 0;
+        }
+    }
+    pthread_rwlock_unlock(&directory_lock);
+    return rc;
+}
+
+const char *session_name(const struct session *session) {
+    return session->user != NULL ? session->user->name : "Unknown";
+}
@@ -0,0 +1,150 @@
+#ifndef CHAT_SESSION_H
+#define CHAT_SESSION_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "chatProtocol.h"
+#include "chatQueue.h"
+
+// Batas jumlah shard untuk bitmask kehadiran di direktori global
+#define CHAT_MAX_SHARDS 256
+#define CHAT_SHARD_MASK_WORDS (CHAT_MAX_SHARDS / 64)
+
+// Himpunan shard yang punya anggota room atau sesi dengan username tertentu.
+// Ditulis di bawah lock direktori, dibaca tanpa lock di jalur pesan.
+struct shard_mask {
+    _Atomic uint64_t words[CHAT_SHARD_MASK_WORDS];
+};
+
+static inline void shard_mask_set(struct shard_mask *mask, int shard, int present) {
+    uint64_t bit = (uint64_t)1 << (shard % 64);
+    if (present) {
+        atomic_fetch_or_explicit(&mask->words[shard / 64], bit, memory_order_release);
+    } else {
+        atomic_fetch_and_explicit(&mask->words[shard / 64], ~bit, memory_order_release);
+    }
+}
+
+static inline int shard_mask_test(const struct shard_mask *mask, int shard) {
+    return (atomic_load_explicit(&mask->words[shard / 64], memory_order_acquire) >> (shard % 64)) & 1;
+}
+
+// Salinan mask pada satu titik waktu
+static inline void shard_mask_copy(struct shard_mask *out, const struct shard_mask *mask) {
+    for (int i = 0; i < CHAT_SHARD_MASK_WORDS; i++) {
+        atomic_store_explicit(&out->words[i], atomic_load_explicit(&mask->words[i], memory_order_acquire),
+                              memory_order_relaxed);
+    }
+}
+
+// Username yang di-intern: satu salinan per nama, dipakai bersama oleh semua
+// sesi dengan nama yang sama. session_fd menunjuk sesi terbaru dengan nama ini;
+// sesi lain dengan nama yang sama tersambung lewat name_next/name_prev, sehingga
+// saat sesi terbaru keluar indeks pindah ke sesi yang masih terhubung.
+//
+// Direktori global username memakai struktur yang sama: refcount berisi jumlah
+// shard yang punya nama ini dan shards menandai shard tersebut.
+struct username {
+    uint32_t hash;
+    unsigned int refcount;
+    int session_fd;
+    struct shard_mask shards;  // hanya untuk direktori global
+    unsigned char len;
+    char name[];
+};
+
+// Hash table open addressing (linear probing) untuk username
+struct username_table {
+    struct username **slots;
+    size_t capacity;
+    size_t count;
+};
+
+struct room;
+
+// Payload terakhir yang diingat per sesi untuk filter pesan duplikat. Payload
+// dibandingkan lewat hash FNV-1a 64 bit dan panjangnya, bukan isinya: pesan
+// berbeda dengan panjang sama baru dianggap duplikat jika hash-nya bertabrakan,
+// peluangnya sekitar 4 / 2^64 per pesan, jadi praktis tidak pernah terjadi.
+#define SESSION_RECENT_PAYLOADS 4
+
+// Data satu koneksi klien
+struct session {
+    int fd;
+    uint32_t generation;      // Membedakan sesi lama dan baru pada fd yang sama (io_uring)
+    // Waktu dalam tick timing wheel shard, untuk heartbeat dan timeout
+    uint32_t connected_tick;
+    uint32_t recv_tick;       // Data terakhir dari klien
+    uint32_t ping_tick;       // PING terakhir dari server
+    uint32_t stall_tick;      // Antrian kirim terakhir maju atau mulai terisi
+    uint32_t throttle_tick;   // THROTTLE terakhir yang dikirim ke klien
+    // Token bucket laju frame dari klien, diisi ulang saat frame berikutnya tiba
+    double msg_tokens;
+    double byte_tokens;
+    uint64_t refill_at;       // Waktu monoton (ns) pengisian terakhir
+    // Hash dan panjang payload CHAT/DIRECT terakhir beserta tick-nya (ring kecil)
+    uint64_t recent_hash[SESSION_RECENT_PAYLOADS];
+    uint32_t recent_len[SESSION_RECENT_PAYLOADS];
+    uint32_t recent_tick[SESSION_RECENT_PAYLOADS];
+    unsigned char recent_next;
+    unsigned char throttled;  // Klien pernah menerima THROTTLE
+    unsigned char flush_pending;
+    unsigned char room_count;
+    unsigned char room_capacity;
+    struct username *user;    // NULL sebelum frame LOGIN diterima
+    int name_prev;            // fd sesi lain dengan username yang sama, -1 = tidak ada
+    int name_next;
+    struct room *active_room; // Tujuan frame CHAT dari klien ini
+    struct room **rooms;      // Semua room yang diikuti
+    struct out_queue queue;
+    struct chat_parser parser;
+};
+
+// Tabel sesi milik satu shard. Sesi hidup disimpan padat di satu array agar
+// broadcast hanya menyentuh memori yang bersebelahan; index_by_fd memetakan fd
+// ke posisi sesi dalam O(1). Penghapusan memindahkan sesi terakhir ke posisi
+// yang kosong, jadi pointer ke sesi hanya valid sampai ada sesi yang dihapus
+// atau ditambah.
+struct session_table {
+    struct session *sessions;
+    size_t count;
+    size_t capacity;
+    int *index_by_fd;
+    size_t fd_capacity;
+    struct username_table users;
+    int shard;  // id shard pemilik, untuk direktori username global
+};
+
+// Hash FNV-1a untuk username dan nama room
+uint32_t chat_hash_name(const char *name, size_t len);
+
+int session_table_init(struct session_table *table, int shard);
+void session_table_free(struct session_table *table);
+
+// Menambah sesi kosong untuk fd (tabel membesar seperlunya). NULL jika gagal.
+struct session *session_add(struct session_table *table, int fd);
+
+// Mencari sesi berdasarkan fd dalam O(1). NULL jika tidak ada.
+struct session *session_get(struct session_table *table, int fd);
+
+// Menghapus sesi beserta parser, antrian kirim, dan referensi username-nya.
+// Pemanggil harus mengeluarkan sesi dari semua room terlebih dahulu.
+void session_remove(struct session_table *table, int fd);
+
+// Mengisi username sesi (di-intern) dan mendaftarkannya ke indeks username
+int session_set_username(struct session_table *table, struct session *session, const char *name, size_t len);
+
+// Mencari sesi berdasarkan username dalam O(1). NULL jika tidak ada.
+struct session *session_find_user(struct session_table *table, const char *name, size_t len);
+
+// Shard yang punya sesi dengan username ini (direktori global, diperbarui saat
+// nama pertama kali muncul atau terakhir hilang di satu shard). 0 jika ada,
+// -1 jika tidak ada shard yang punya nama tersebut.
+int session_directory_find(const char *name, size_t len, struct shard_mask *shards);
+
+// Nama untuk ditampilkan: username atau "Unknown" sebelum login
+const char *session_name(const struct session *session);
+
+#endif
@@ -0,0 +1,180 @@
+#include <stdlib.h>
+
+#include "chatTimer.h"
+
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_INITIAL_CAPACITY 1024
+
+// Slot untuk timer yang kedaluwarsa pada tick expires, dilihat dari waktu
+// wheel saat ini. Timer yang sudah jatuh tempo masuk slot level 0 tick ini.
+static int timer_slot(const struct timer_wheel *wheel, uint64_t expires) {
+    if (expires <= wheel->now) {
+        return (int)(wheel->now & TIMER_WHEEL_MASK);
+    }
+    uint64_t delta = expires - wheel->now;
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        if (delta < (uint64_t)1 << (TIMER_WHEEL_BITS * (level + 1))) {
+            return level * TIMER_WHEEL_SLOTS + (int)((expires >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK);
+        }
+    }
+    // Di luar jangkauan wheel: parkir di ujung level teratas, posisinya
+    // dihitung ulang saat slot itu diturunkan
+    uint64_t last = wheel->now + ((uint64_t)1 << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1;
+    int level = TIMER_WHEEL_LEVELS - 1;
+    return level * TIMER_WHEEL_SLOTS + (int)((last >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK);
+}
+
+static void timer_link(struct timer_wheel *wheel, int id) {
+    struct timer_entry *entry = &wheel->entries[id];
+    int slot = timer_slot(wheel, entry->expires);
+    entry->slot = slot;
+    entry->prev = -1;
+    entry->next = wheel->heads[slot];
+    if (entry->next != -1) {
+        wheel->entries[entry->next].prev = id;
+    }
+    wheel->heads[slot] = id;
+}
+
+static void timer_unlink(struct timer_wheel *wheel, int id) {
+    struct timer_entry *entry = &wheel->entries[id];
+    if (entry->prev != -1) {
+        wheel->entries[entry->prev].next = entry->next;
+    } else {
+        wheel->heads[entry->slot] = entry->next;
+    }
+    if (entry->next != -1) {
+        wheel->entries[entry->next].prev = entry->prev;
+    }
+    entry->slot = -1;
+}
+
+// Memindahkan semua timer di satu slot level atas ke posisi barunya
+static void timer_cascade(struct timer_wheel *wheel, int slot) {
+    int id = wheel->heads[slot];
+    wheel->heads[slot] = -1;
+    while (id != -1) {
+        int next = wheel->entries[id].next;
+        timer_link(wheel, id);
+        id = next;
+    }
+}
+
+static int timer_grow(struct timer_wheel *wheel, size_t needed) {
+    size_t capacity = wheel->capacity;
+    while (capacity <= needed) {
+        capacity *= 2;
+    }
+    struct timer_entry *grown = realloc(wheel->entries, capacity * sizeof(*grown));
+    if (grown == NULL) {
+        return -1;
+    }
+    for (size_t i = wheel->capacity; i < capacity; i++) {
+        grown[i].slot = -1;
+    }
+    wheel->entries = grown;
+    wheel->capacity = capacity;
+    return 0;
+}
+
+int timer_wheel_init(struct timer_wheel *wheel, uint64_t now) {
+    wheel->now = now;
+    wheel->count = 0;
+    for (int i = 0; i < TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS; i++) {
+        wheel->heads[i] = -1;
+    }
+    wheel->capacity = TIMER_INITIAL_CAPACITY;
+    wheel->entries = malloc(wheel->capacity * sizeof(*wheel->entries));
+    if (wheel->entries == NULL) {
+        return -1;
+    }
+    for (size_t i = 0; i < wheel->capacity; i++) {
+        wheel->entries[i].slot = -1;
+    }
+    return 0;
+}
+
+void timer_wheel_free(struct timer_wheel *wheel) {
+    free(wheel->entries);
+    wheel->entries = NULL;
+    wheel->capacity = 0;
+    wheel->count = 0;
+}
+
+int timer_schedule(struct timer_wheel *wheel, int id, uint64_t expires) {
+    if (id < 0) {
+        return -1;
+    }
+    if ((size_t)id >= wheel->capacity && timer_grow(wheel, (size_t)id) < 0) {
+        return -1;
+    }
+    struct timer_entry *entry = &wheel->entries[id];
+    if (entry->slot != -1) {
+        timer_unlink(wheel, id);
+    } else {
+        wheel->count++;
+    }
+    // Slot tick saat ini sedang (atau sudah) diproses
+    entry->expires = expires > wheel->now ? expires : wheel->now + 1;
+    timer_link(wheel, id);
+    return 0;
+}
+
+void timer_cancel(struct timer_wheel *wheel, int id) {
+    if (id < 0 || (size_t)id >= wheel->capacity || wheel->entries[id].slot == -1) {
+        return;
+    }
+    timer_unlink(wheel, id);
+    wheel->count--;
+}
+
+uint64_t timer_expires(const struct timer_wheel *wheel, int id) {
+    if (id < 0 || (size_t)id >= wheel->capacity || wheel->entries[id].slot == -1) {
+        return 0;
+    }
+    return wheel->entries[id].expires;
+}
+
+size_t timer_advance(struct timer_wheel *wheel, uint64_t now, timer_fire_fn fire, void *ctx) {
+    size_t fired = 0;
+    while (wheel->now < now) {
+        if (wheel->count == 0) {
+            // Wheel kosong: tidak ada yang perlu diturunkan, langsung lompat
+            wheel->now = now;
+            break;
+        }
+        uint64_t tick = ++wheel->now;
+
+        // Setiap 64^level tick, slot level tersebut yang jatuh tempo diturunkan,
+        // mulai dari level tertinggi
+        int top = 0;
+        while (top + 1 < TIMER_WHEEL_LEVELS &&
+               (tick & (((uint64_t)1 << (TIMER_WHEEL_BITS * (top + 1))) - 1)) == 0) {
+            top++;
+        }
+        for (int level = top; level >= 1; level--) {
+            timer_cascade(wheel, level * TIMER_WHEEL_SLOTS + (int)((tick >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK));
+        }
+
+        int *head = &wheel->heads[tick & TIMER_WHEEL_MASK];
+        while (*head != -1) {
+            int id = *head;
+            timer_unlink(wheel, id);
+            wheel->count--;
+            fired++;
+            fire(ctx, id);
+        }
+    }
+    return fired;
+}
+
+uint64_t timer_next_tick(const struct timer_wheel *wheel) {
+    if (wheel->count == 0) {
+        return UINT64_MAX;
+    }
+    for (uint64_t tick = wheel->now + 1;; tick++) {
+        if (wheel->heads[tick & TIMER_WHEEL_MASK] != -1 || (tick & TIMER_WHEEL_MASK) == 0) {
+            return tick;
+        }
+    }
+}
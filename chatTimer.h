@@ -0,0 +1,61 @@
+#ifndef CHAT_TIMER_H
+#define CHAT_TIMER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Timing wheel hierarkis (hashed) untuk timeout sesi. Waktu dihitung dalam
+// tick; setiap level punya 64 slot, dan level berikutnya mencakup rentang 64
+// kali lebih panjang. Timer disimpan di daftar berantai ganda per slot,
+// sehingga pasang, geser, dan batal selalu O(1). Saat waktu maju, hanya slot
+// level 0 milik tick tersebut yang diproses; timer di level atas diturunkan
+// (cascade) sekali setiap 64 tick level di bawahnya.
+//
+// Timer diidentifikasi dengan id kecil (fd sesi) dan disimpan di array yang
+// diindeks id, bukan di dalam sesi, karena sesi berpindah posisi di tabel.
+// Setiap id hanya punya satu timer.
+
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS 4  // 64^4 tick; dengan tick 100 ms sekitar 194 hari
+
+struct timer_entry {
+    int next;          // id berikutnya di slot yang sama, -1 = akhir
+    int prev;          // id sebelumnya, -1 = kepala slot
+    int slot;          // level * TIMER_WHEEL_SLOTS + slot, -1 = tidak terpasang
+    uint64_t expires;  // tick kedaluwarsa
+};
+
+struct timer_wheel {
+    uint64_t now;      // tick terakhir yang sudah diproses
+    size_t count;      // jumlah timer terpasang
+    int heads[TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS];
+    struct timer_entry *entries;
+    size_t capacity;
+};
+
+// Dipanggil untuk setiap timer yang kedaluwarsa. Timer sudah dilepas sebelum
+// callback, jadi callback boleh memasang ulang atau membatalkan timer mana pun.
+typedef void (*timer_fire_fn)(void *ctx, int id);
+
+int timer_wheel_init(struct timer_wheel *wheel, uint64_t now);
+void timer_wheel_free(struct timer_wheel *wheel);
+
+// Memasang timer id pada tick expires, menggantikan timer id sebelumnya.
+// Tick yang sudah lewat dibulatkan ke tick berikutnya. 0 jika berhasil.
+int timer_schedule(struct timer_wheel *wheel, int id, uint64_t expires);
+void timer_cancel(struct timer_wheel *wheel, int id);
+
+// Tick kedaluwarsa timer id, 0 jika tidak terpasang
+uint64_t timer_expires(const struct timer_wheel *wheel, int id);
+
+// Memajukan waktu sampai tick now dan menjalankan fire untuk semua timer
+// yang kedaluwarsa. Mengembalikan jumlah timer yang dijalankan.
+size_t timer_advance(struct timer_wheel *wheel, uint64_t now, timer_fire_fn fire, void *ctx);
+
+// Tick berikutnya yang perlu diproses (timer level 0 terdekat atau cascade
+// berikutnya), UINT64_MAX jika tidak ada timer. Hanya memeriksa slot level 0,
+// jadi dipakai untuk timeout event loop tanpa memindai sesi.
+uint64_t timer_next_tick(const struct timer_wheel *wheel);
+
+#endif
@@ -0,0 +1,499 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "chatUring.h"
+
+#ifdef CHAT_HAVE_IO_URING
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+// Grup buffer ring yang dipakai recv multishot
+#define URING_BUFFER_GROUP 0
+
+struct chat_uring {
+    int fd;
+    unsigned long syscalls;
+
+    // Submission queue. Indeks sq_array dibuat identitas sekali saat setup,
+    // jadi SQE ke-n selalu berada di sqes[n & mask].
+    void *sq_map;
+    size_t sq_map_size;
+    _Atomic unsigned int *sq_head;
+    _Atomic unsigned int *sq_tail;
+    unsigned int sq_mask;
+    unsigned int sq_entries;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    unsigned int sqe_tail;   // tail lokal, dipublikasikan ke kernel saat submit
+    unsigned int unsubmitted;
+
+    // Completion queue
+    void *cq_map;
+    size_t cq_map_size;
+    _Atomic unsigned int *cq_head;
+    _Atomic unsigned int *cq_tail;
+    unsigned int cq_mask;
+    struct io_uring_cqe *cqes;
+
+    // Buffer ring untuk recv
+    struct io_uring_buf_ring *buf_ring;
+    size_t buf_ring_size;
+    _Atomic uint16_t *buf_tail;
+    uint16_t buf_local_tail;
+    unsigned int buf_mask;
+    unsigned int buf_size;
+    char *buffers;
+    size_t buffers_size;
+};
+
+static int sys_setup(unsigned int entries, struct io_uring_params *params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int sys_enter(int fd, unsigned int to_submit, unsigned int wait_nr, unsigned int flags, const void *arg, size_t argsz) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, wait_nr, flags, arg, argsz);
+}
+
+static int sys_register(int fd, unsigned int opcode, void *arg, unsigned int nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+// Ring dengan task work yang hanya dijalankan saat thread pemilik memanggil
+// io_uring_enter(); pada kernel yang belum mendukungnya dipakai ring biasa.
+static int setup_ring(unsigned int entries, struct io_uring_params *params) {
+    memset(params, 0, sizeof(*params));
+    params->flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_SINGLE_ISSUER |
+                    IORING_SETUP_DEFER_TASKRUN;
+    params->cq_entries = entries * 4; // multishot menghasilkan banyak CQE per SQE
+    int fd = sys_setup(entries, params);
+    if (fd < 0 && errno == EINVAL) {
+        memset(params, 0, sizeof(*params));
+        params->flags = IORING_SETUP_CQSIZE;
+        params->cq_entries = entries * 4;
+        fd = sys_setup(entries, params);
+    }
+    return fd;
+}
+
+int chat_uring_probe(const char **reason) {
+    struct io_uring_params params;
+    int fd = setup_ring(8, &params);
+    if (fd < 0) {
+        *reason = errno == ENOSYS ? "kernel tanpa io_uring" : "io_uring_setup ditolak";
+        return -1;
+    }
+
+    size_t probe_size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = calloc(1, probe_size);
+    int rc = -1;
+    if (probe == NULL) {
+        *reason = "malloc";
+    } else if (sys_register(fd, IORING_REGISTER_PROBE, probe, 256) < 0) {
+        *reason = "IORING_REGISTER_PROBE tidak didukung";
+    } else if (probe->last_op < IORING_OP_SENDMSG_ZC ||
+               !(probe->ops[IORING_OP_SENDMSG_ZC].flags & IO_URING_OP_SUPPORTED)) {
+        // SENDMSG_ZC (Linux 6.1) juga menandakan recv multishot dan buffer ring tersedia
+        *reason = "kernel belum mendukung sendmsg zero-copy (butuh Linux 6.1)";
+    } else {
+        rc = 0;
+    }
+    free(probe);
+    close(fd);
+    return rc;
+}
+
+static void *map_ring(int fd, size_t size, off_t offset) {
+    return mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+}
+
+static int setup_buffers(struct chat_uring *ring, unsigned int count, unsigned int size) {
+    ring->buf_ring_size = count * sizeof(struct io_uring_buf);
+    ring->buf_ring = mmap(NULL, ring->buf_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring->buf_ring == MAP_FAILED) {
+        ring->buf_ring = NULL;
+        return -1;
+    }
+    ring->buffers_size = (size_t)count * size;
+    ring->buffers = mmap(NULL, ring->buffers_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring->buffers == MAP_FAILED) {
+        ring->buffers = NULL;
+        return -1;
+    }
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)ring->buf_ring;
+    reg.ring_entries = count;
+    reg.bgid = URING_BUFFER_GROUP;
+    if (sys_register(ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        return -1;
+    }
+
+    ring->buf_tail = (_Atomic uint16_t *)&ring->buf_ring->tail;
+    ring->buf_mask = count - 1;
+    ring->buf_size = size;
+    ring->buf_local_tail = 0;
+    for (unsigned int i = 0; i < count; i++) {
+        chat_uring_recycle(ring, (int)i);
+    }
+    return 0;
+}
+
+struct chat_uring *chat_uring_create(unsigned int entries, unsigned int buffer_count, unsigned int buffer_size) {
+    struct chat_uring *ring = calloc(1, sizeof(*ring));
+    if (ring == NULL) {
+        return NULL;
+    }
+
+    struct io_uring_params params;
+    ring->fd = setup_ring(entries, &params);
+    if (ring->fd < 0) {
+        free(ring);
+        return NULL;
+    }
+
+    ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_map_size > ring->sq_map_size) {
+            ring->sq_map_size = ring->cq_map_size;
+        }
+    }
+    ring->sq_map = map_ring(ring->fd, ring->sq_map_size, IORING_OFF_SQ_RING);
+    if (ring->sq_map == MAP_FAILED) {
+        ring->sq_map = NULL;
+        goto fail;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_map = ring->sq_map;
+    } else {
+        ring->cq_map = map_ring(ring->fd, ring->cq_map_size, IORING_OFF_CQ_RING);
+        if (ring->cq_map == MAP_FAILED) {
+            ring->cq_map = NULL;
+            goto fail;
+        }
+    }
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = map_ring(ring->fd, ring->sqes_size, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        ring->sqes = NULL;
+        goto fail;
+    }
+
+    char *sq = ring->sq_map;
+    ring->sq_head = (_Atomic unsigned int *)(sq + params.sq_off.head);
+    ring->sq_tail = (_Atomic unsigned int *)(sq + params.sq_off.tail);
+    ring->sq_mask = *(unsigned int *)(sq + params.sq_off.ring_mask);
+    ring->sq_entries = *(unsigned int *)(sq + params.sq_off.ring_entries);
+    unsigned int *sq_array = (unsigned int *)(sq + params.sq_off.array);
+    for (unsigned int i = 0; i < ring->sq_entries; i++) {
+        sq_array[i] = i;
+    }
+    ring->sqe_tail = atomic_load_explicit(ring->sq_tail, memory_order_relaxed);
+
+    char *cq = ring->cq_map;
+    ring->cq_head = (_Atomic unsigned int *)(cq + params.cq_off.head);
+    ring->cq_tail = (_Atomic unsigned int *)(cq + params.cq_off.tail);
+    ring->cq_mask = *(unsigned int *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+    if (setup_buffers(ring, buffer_count, buffer_size) < 0) {
+        goto fail;
+    }
+    return ring;
+
+fail:
+    chat_uring_destroy(ring);
+    return NULL;
+}
+
+void chat_uring_destroy(struct chat_uring *ring) {
+    if (ring == NULL) {
+        return;
+    }
+    // Menutup fd ring membatalkan semua request yang masih berjalan
+    close(ring->fd);
+    if (ring->sqes != NULL) {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if (ring->cq_map != NULL && ring->cq_map != ring->sq_map) {
+        munmap(ring->cq_map, ring->cq_map_size);
+    }
+    if (ring->sq_map != NULL) {
+        munmap(ring->sq_map, ring->sq_map_size);
+    }
+    if (ring->buffers != NULL) {
+        munmap(ring->buffers, ring->buffers_size);
+    }
+    if (ring->buf_ring != NULL) {
+        munmap(ring->buf_ring, ring->buf_ring_size);
+    }
+    free(ring);
+}
+
+// Mengambil SQE kosong. Jika SQ penuh, SQE yang sudah disiapkan dikirim dulu.
+static struct io_uring_sqe *get_sqe(struct chat_uring *ring) {
+    unsigned int head = atomic_load_explicit(ring->sq_head, memory_order_acquire);
+    if (ring->sqe_tail - head >= ring->sq_entries) {
+        if (chat_uring_submit_wait(ring, 0, -1) < 0) {
+            return NULL;
+        }
+        head = atomic_load_explicit(ring->sq_head, memory_order_acquire);
+        if (ring->sqe_tail - head >= ring->sq_entries) {
+            errno = EBUSY;
+            return NULL;
+        }
+    }
+    struct io_uring_sqe *sqe = &ring->sqes[ring->sqe_tail & ring->sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sqe_tail++;
+    ring->unsubmitted++;
+    // Tail dipublikasikan setelah SQE terisi, lihat publish_sqes()
+    return sqe;
+}
+
+static void publish_sqes(struct chat_uring *ring) {
+    atomic_store_explicit(ring->sq_tail, ring->sqe_tail, memory_order_release);
+}
+
+int chat_uring_accept_multishot(struct chat_uring *ring, int fd, uint64_t user_data) {
+    struct io_uring_sqe *sqe = get_sqe(ring);
+    if (sqe == NULL) {
+        return -1;
+    }
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = user_data;
+    return 0;
+}
+
+int chat_uring_recv_multishot(struct chat_uring *ring, int fd, uint64_t user_data) {
+    struct io_uring_sqe *sqe = get_sqe(ring);
+    if (sqe == NULL) {
+        return -1;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUFFER_GROUP;
+    sqe->user_data = user_data;
+    return 0;
+}
+
+int chat_uring_read(struct chat_uring *ring, int fd, void *buf, size_t len, uint64_t user_data) {
+    struct io_uring_sqe *sqe = get_sqe(ring);
+    if (sqe == NULL) {
+        return -1;
+    }
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)buf;
+    sqe->len = (uint32_t)len;
+    sqe->off = (uint64_t)-1; // posisi file saat ini
+    sqe->user_data = user_data;
+    return 0;
+}
+
+int chat_uring_sendmsg(struct chat_uring *ring, int fd, const struct msghdr *msg, int zerocopy, uint64_t user_data) {
+    struct io_uring_sqe *sqe = get_sqe(ring);
+    if (sqe == NULL) {
+        return -1;
+    }
+    sqe->opcode = zerocopy ? IORING_OP_SENDMSG_ZC : IORING_OP_SENDMSG;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)msg;
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = user_data;
+    return 0;
+}
+
+int chat_uring_cancel(struct chat_uring *ring, uint64_t target, uint64_t user_data) {
+    struct io_uring_sqe *sqe = get_sqe(ring);
+    if (sqe == NULL) {
+        return -1;
+    }
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = target;
+    sqe->user_data = user_data;
+    return 0;
+}
+
+int chat_uring_submit_wait(struct chat_uring *ring, unsigned int wait_nr, int64_t timeout_ns) {
+    publish_sqes(ring);
+    if (ring->unsubmitted == 0 && wait_nr == 0) {
+        return 0;
+    }
+    // GETEVENTS juga menjalankan task work yang ditunda (DEFER_TASKRUN).
+    // Batas waktu tunggu dikirim lewat EXT_ARG, tanpa SQE timeout terpisah.
+    unsigned int flags = IORING_ENTER_GETEVENTS;
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    const void *argp = NULL;
+    size_t argsz = 0;
+    if (timeout_ns >= 0 && wait_nr > 0) {
+        ts.tv_sec = timeout_ns / 1000000000;
+        ts.tv_nsec = timeout_ns % 1000000000;
+        memset(&arg, 0, sizeof(arg));
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+        argp = &arg;
+        argsz = sizeof(arg);
+        flags |= IORING_ENTER_EXT_ARG;
+    }
+    int submitted = sys_enter(ring->fd, ring->unsubmitted, wait_nr, flags, argp, argsz);
+    ring->syscalls++;
+    if (submitted < 0) {
+        return -1;
+    }
+    ring->unsubmitted -= (unsigned int)submitted < ring->unsubmitted ? (unsigned int)submitted : ring->unsubmitted;
+    return 0;
+}
+
+int chat_uring_flush(struct chat_uring *ring) {
+    publish_sqes(ring);
+    int submitted = sys_enter(ring->fd, ring->unsubmitted, 0, IORING_ENTER_GETEVENTS, NULL, 0);
+    ring->syscalls++;
+    if (submitted < 0) {
+        return -1;
+    }
+    ring->unsubmitted -= (unsigned int)submitted < ring->unsubmitted ? (unsigned int)submitted : ring->unsubmitted;
+    return 0;
+}
+
+int chat_uring_next(struct chat_uring *ring, struct chat_uring_cqe *out) {
+    unsigned int head = atomic_load_explicit(ring->cq_head, memory_order_relaxed);
+    if (head == atomic_load_explicit(ring->cq_tail, memory_order_acquire)) {
+        return 0;
+    }
+    const struct io_uring_cqe *cqe = &ring->cqes[head & ring->cq_mask];
+    out->user_data = cqe->user_data;
+    out->res = cqe->res;
+    out->flags = 0;
+    if (cqe->flags & IORING_CQE_F_MORE) {
+        out->flags |= CHAT_URING_MORE;
+    }
+    if (cqe->flags & IORING_CQE_F_NOTIF) {
+        out->flags |= CHAT_URING_NOTIF;
+    }
+    out->buffer = (cqe->flags & IORING_CQE_F_BUFFER) ? (int)(cqe->flags >> IORING_CQE_BUFFER_SHIFT) : -1;
+    atomic_store_explicit(ring->cq_head, head + 1, memory_order_release);
+    return 1;
+}
+
+const char *chat_uring_buffer(struct chat_uring *ring, int buffer) {
+    return ring->buffers + (size_t)buffer * ring->buf_size;
+}
+
+void chat_uring_recycle(struct chat_uring *ring, int buffer) {
+    struct io_uring_buf *entry = &ring->buf_ring->bufs[ring->buf_local_tail & ring->buf_mask];
+    entry->addr = (uint64_t)(uintptr_t)chat_uring_buffer(ring, buffer);
+    entry->len = ring->buf_size;
+    entry->bid = (uint16_t)buffer;
+    ring->buf_local_tail++;
+    atomic_store_explicit(ring->buf_tail, ring->buf_local_tail, memory_order_release);
+}
+
+unsigned long chat_uring_take_syscalls(struct chat_uring *ring) {
+    unsigned long count = ring->syscalls;
+    ring->syscalls = 0;
+    return count;
+}
+
+#else
+
+// Dibangun tanpa header io_uring yang cukup baru: backend selalu jatuh ke epoll
+
+int chat_uring_probe(const char **reason) {
+    *reason = "server dibangun tanpa dukungan io_uring";
+    return -1;
+}
+
+struct chat_uring *chat_uring_create(unsigned int entries, unsigned int buffer_count, unsigned int buffer_size) {
+    (void)entries;
+    (void)buffer_count;
+    (void)buffer_size;
+    errno = ENOSYS;
+    return NULL;
+}
+
+void chat_uring_destroy(struct chat_uring *ring) {
+    (void)ring;
+}
+
+int chat_uring_accept_multishot(struct chat_uring *ring, int fd, uint64_t user_data) {
+    (void)ring;
+    (void)fd;
+    (void)user_data;
+    errno = ENOSYS;
+    return -1;
+}
+
+int chat_uring_recv_multishot(struct chat_uring *ring, int fd, uint64_t user_data) {
+    return chat_uring_accept_multishot(ring, fd, user_data);
+}
+
+int chat_uring_read(struct chat_uring *ring, int fd, void *buf, size_t len, uint64_t user_data) {
+    (void)buf;
+    (void)len;
+    return chat_uring_accept_multishot(ring, fd, user_data);
+}
+
+int chat_uring_sendmsg(struct chat_uring *ring, int fd, const struct msghdr *msg, int zerocopy, uint64_t user_data) {
+    (void)msg;
+    (void)zerocopy;
+    return chat_uring_accept_multishot(ring, fd, user_data);
+}
+
+int chat_uring_cancel(struct chat_uring *ring, uint64_t target, uint64_t user_data) {
+    (void)target;
+    (void)user_data;
+    return chat_uring_accept_multishot(ring, -1, 0);
+}
+
+int chat_uring_submit_wait(struct chat_uring *ring, unsigned int wait_nr, int64_t timeout_ns) {
+    (void)ring;
+    (void)wait_nr;
+    (void)timeout_ns;
+    errno = ENOSYS;
+    return -1;
+}
+
+int chat_uring_flush(struct chat_uring *ring) {
+    (void)ring;
+    errno = ENOSYS;
+    return -1;
+}
+
+int chat_uring_next(struct chat_uring *ring, struct chat_uring_cqe *cqe) {
+    (void)ring;
+    (void)cqe;
+    return 0;
+}
+
+const char *chat_uring_buffer(struct chat_uring *ring, int buffer) {
+    (void)ring;
+    (void)buffer;
+    return NULL;
+}
+
+void chat_uring_recycle(struct chat_uring *ring, int buffer) {
+    (void)ring;
+    (void)buffer;
+}
+
+unsigned long chat_uring_take_syscalls(struct chat_uring *ring) {
+    (void)ring;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef CHAT_URING_H
+#define CHAT_URING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+// Pembungkus tipis io_uring lewat syscall langsung (tanpa liburing) untuk
+// backend I/O server. Satu ring dimiliki satu shard dan hanya dipakai dari
+// thread shard tersebut. Receive memakai buffer ring yang disediakan ke
+// kernel: kernel memilih buffer saat data tiba, jadi tidak ada memori yang
+// tertahan untuk klien yang diam.
+//
+// Semua fungsi prep hanya mengisi SQE; tidak ada syscall sampai
+// chat_uring_submit_wait() (kecuali SQ penuh dan harus dikirim lebih dulu).
+
+// Flag hasil completion
+#define CHAT_URING_MORE  0x1  // request multishot masih aktif
+#define CHAT_URING_NOTIF 0x2  // notifikasi zero-copy: buffer kirim boleh dilepas
+
+struct chat_uring;
+
+struct chat_uring_cqe {
+    uint64_t user_data;
+    int32_t res;        // hasil operasi atau -errno
+    unsigned int flags; // CHAT_URING_*
+    int buffer;         // id buffer dari buffer ring, -1 jika tidak ada
+};
+
+// Memeriksa apakah kernel mendukung semua operasi yang dibutuhkan backend
+// (multishot accept/recv, buffer ring, sendmsg zero-copy). 0 jika didukung;
+// jika tidak, reason berisi penjelasan singkat.
+int chat_uring_probe(const char **reason);
+
+// Membuat ring dengan entries SQE dan buffer ring berisi buffer_count buffer
+// berukuran buffer_size. Harus dipanggil dari thread yang akan memakainya.
+struct chat_uring *chat_uring_create(unsigned int entries, unsigned int buffer_count, unsigned int buffer_size);
+void chat_uring_destroy(struct chat_uring *ring);
+
+// Menyiapkan request. 0 jika berhasil, -1 jika SQ tetap penuh.
+int chat_uring_accept_multishot(struct chat_uring *ring, int fd, uint64_t user_data);
+int chat_uring_recv_multishot(struct chat_uring *ring, int fd, uint64_t user_data);
+int chat_uring_read(struct chat_uring *ring, int fd, void *buf, size_t len, uint64_t user_data);
+// msg (beserta iov-nya) harus tetap valid sampai completion diterima
+int chat_uring_sendmsg(struct chat_uring *ring, int fd, const struct msghdr *msg, int zerocopy, uint64_t user_data);
+
+// Membatalkan request dengan user_data target. Request yang dibatalkan selesai
+// dengan -ECANCELED (tanpa CHAT_URING_MORE); pembatalan sendiri menghasilkan
+// completion dengan user_data, berisi -ENOENT jika target sudah selesai.
+// Kernel mencari target secara linear, jadi jangan dipakai per sesi.
+int chat_uring_cancel(struct chat_uring *ring, uint64_t target, uint64_t user_data);
+
+// Mengirim semua SQE yang sudah disiapkan dan menunggu minimal wait_nr
+// completion dalam satu io_uring_enter(), paling lama timeout_ns (-1 = tanpa
+// batas). 0 jika berhasil, -1 jika gagal (errno; ETIME jika waktu habis).
+int chat_uring_submit_wait(struct chat_uring *ring, unsigned int wait_nr, int64_t timeout_ns);
+
+// Seperti chat_uring_submit_wait() tanpa menunggu, tapi selalu masuk ke kernel:
+// task work yang ditunda dijalankan dan completion yang tertahan di daftar
+// overflow (CQ sempat penuh) dipindahkan ke CQ. 0 jika berhasil, -1 jika gagal.
+int chat_uring_flush(struct chat_uring *ring);
+
+// Mengambil satu completion. 1 jika ada, 0 jika CQ kosong.
+int chat_uring_next(struct chat_uring *ring, struct chat_uring_cqe *cqe);
+
+// Isi buffer hasil recv dan pengembaliannya ke kernel setelah selesai dipakai
+const char *chat_uring_buffer(struct chat_uring *ring, int buffer);
+void chat_uring_recycle(struct chat_uring *ring, int buffer);
+
+// Jumlah io_uring_enter() sejak pemanggilan sebelumnya (untuk metrik syscall)
+unsigned long chat_uring_take_syscalls(struct chat_uring *ring);
+
+#endif
@@ -1,20 +1,33 @@
+#define _GNU_SOURCE
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <sys/select.h>
 #include <time.h>
 
+#include "chatProtocol.h"
+
 #ifndef CLOCK_MONOTONIC
 #define CLOCK_MONOTONIC 1
 #endif
 
 #define PORT 8080
-#define BUFFER_SIZE 1024
 #define MAX_USERNAME_LENGTH 50
 
+// Heartbeat dan reconnect
+#define CLIENT_PING_INTERVAL_MS 15000  // PING jika server diam selama ini
+#define CLIENT_PONG_TIMEOUT_MS 10000   // koneksi dianggap mati jika PING tidak dibalas
+#define RECONNECT_MIN_MS 500
+#define RECONNECT_MAX_MS 30000
+
+// Hasil satu sesi koneksi
+#define CLIENT_EXIT 0   // pengguna keluar
+#define CLIENT_RETRY 1  // koneksi gagal atau putus, hubungkan ulang
+
 // Fungsi untuk validasi username
 int validate_username(const char *username) {
     if (strlen(username) == 0 || strlen(username) > MAX_USERNAME_LENGTH) {
@@ -30,17 +43,92 @@ int validate_username(const char *username) {
     return 1;
 }
 
-// Fungsi untuk menghubungkan client ke server
-void connect_to_server(const char *username, int batch_mode) {
+// Menampilkan satu frame dari server
+void print_frame(const struct chat_frame *frame) {
+    size_t offset = 0;
+    const char *sender;
+    int sender_len = chat_read_field(frame->payload, frame->length, &offset, &sender);
+
+    if (frame->type == FRAME_CHAT && sender_len >= 0) {
+        // Payload: u8 panjang username | username | u8 panjang room | room | teks
+        const char *room;
+        int room_len = chat_read_field(frame->payload, frame->length, &offset, &room);
+        if (room_len >= 0) {
+            printf("\nPesan dari server: %s[CHAT] [#%.*s] [%.*s]: %.*s\n",
+                   (frame->flags & CHAT_FLAG_HISTORY) ? "[RIWAYAT] " : "", room_len, room, sender_len, sender,
+                   (int)(frame->length - offset), frame->payload + offset);
+            return;
+        }
+    } else if (frame->type == FRAME_DIRECT && sender_len >= 0) {
+        // Payload: u8 panjang username | username | teks
+        printf("\nPesan pribadi dari [%.*s]: %.*s\n", sender_len, sender,
+               (int)(frame->length - offset), frame->payload + offset);
+        return;
+    }
+    printf("\nPesan dari server: %.*s\n", (int)frame->length, frame->payload);
+}
+
+// Mengirim perintah /join, /leave, /rooms, atau /msg. Mengembalikan 1 jika
+// baris adalah perintah (sudah diproses), 0 jika pesan biasa, -1 jika gagal kirim.
+int send_command(int sock, const char *line) {
+    if (strncmp(line, "/join ", 6) == 0) {
+        return chat_send_frame(sock, FRAME_JOIN, line + 6, strlen(line + 6)) < 0 ? -1 : 1;
+    }
+    if (strncmp(line, "/leave ", 7) == 0) {
+        return chat_send_frame(sock, FRAME_LEAVE, line + 7, strlen(line + 7)) < 0 ? -1 : 1;
+    }
+    if (strcmp(line, "/rooms") == 0) {
+        return chat_send_frame(sock, FRAME_LIST, NULL, 0) < 0 ? -1 : 1;
+    }
+    if (strncmp(line, "/msg ", 5) == 0) {
+        // Payload: u8 panjang username tujuan | username | teks
+        const char *target = line + 5;
+        size_t target_len = strcspn(target, " ");
+        if (target_len == 0 || target_len > CHAT_USERNAME_MAX || target[target_len] == '\0') {
+            printf("Penggunaan: /msg <username> <pesan>\n");
+            return 1;
+        }
+        const char *text = target + target_len + 1;
+        size_t text_len = strlen(text);
+        char *payload = malloc(1 + target_len + text_len);
+        if (payload == NULL) {
+            perror("malloc");
+            return 1;
+        }
+        payload[0] = (char)target_len;
+        memcpy(payload + 1, target, target_len);
+        memcpy(payload + 1 + target_len, text, text_len);
+        int rc = chat_send_frame(sock, FRAME_DIRECT, payload, 1 + target_len + text_len);
+        free(payload);
+        return rc < 0 ? -1 : 1;
+    }
+    return 0;
+}
+
+// Waktu monoton dalam milidetik
+uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+// Fungsi untuk menghubungkan client ke server. Mengembalikan CLIENT_EXIT jika
+// pengguna keluar, CLIENT_RETRY jika koneksi gagal atau putus dan perlu
+// dihubungkan ulang. *connected diisi 1 jika sempat terhubung; *retry_after_ms
+// diisi saran waktu tunggu dari frame REJECT.
+int connect_to_server(const char *username, int batch_mode, int *connected, uint32_t *retry_after_ms) {
     int sock = 0;
     struct sockaddr_in serv_addr;
-    char buffer[BUFFER_SIZE] = {0};
+    struct chat_parser parser;
+    char *line = NULL;
+    size_t line_cap = 0;
     struct timespec start, end;
+    int result = CLIENT_RETRY;
 
     // Membuat socket
     if ((sock = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
         perror("Gagal membuat socket");
-        return;
+        return CLIENT_EXIT;
     }
 
     serv_addr.sin_family = AF_INET;
@@ -50,7 +138,7 @@ void connect_to_server(const char *username, int batch_mode) {
     if (inet_pton(AF_INET, "127.0.0.1", &serv_addr.sin_addr) <= 0) {
         perror("Alamat tidak valid atau tidak didukung");
         close(sock);
-        return;
+        return CLIENT_EXIT;
     }
 
     // Mencatat waktu sebelum mencoba koneksi
@@ -60,25 +148,35 @@ void connect_to_server(const char *username, int batch_mode) {
     if (connect(sock, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
         perror("Gagal menghubungkan ke server");
         close(sock);
-        return;
+        return CLIENT_RETRY;
     }
+    *connected = 1;
 
     // Mencatat waktu setelah koneksi berhasil
     clock_gettime(CLOCK_MONOTONIC, &end);
     double response_time = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
     printf("Client %s terhubung dalam waktu %.2f ms\n", username, response_time);
 
-    // Mengirimkan username ke server dalam format yang sesuai
-    char username_message[BUFFER_SIZE];
-    snprintf(username_message, sizeof(username_message), "USERNAME:%s", username);
-    if (send(sock, username_message, strlen(username_message), 0) <= 0) {
+    // Mengirimkan username ke server sebagai frame login
+    if (chat_send_frame(sock, FRAME_LOGIN, username, strlen(username)) < 0) {
         perror("Gagal mengirimkan username ke server");
         close(sock);
-        return;
+        return CLIENT_RETRY;
+    }
+
+    if (chat_parser_init(&parser, CHAT_DEFAULT_MAX_PAYLOAD) < 0) {
+        perror("Gagal membuat buffer penerima");
+        close(sock);
+        return CLIENT_EXIT;
     }
 
     fd_set readfds;
     int max_sd = sock;
+    int show_prompt = 1;
+    // Heartbeat: PING dikirim saat server diam, koneksi dianggap mati jika
+    // tidak ada balasan sampai batas waktu
+    uint64_t last_recv = now_ms();
+    uint64_t ping_sent = 0;
 
     // Loop utama untuk chat
     while (1) {
@@ -89,73 +187,194 @@ void connect_to_server(const char *username, int batch_mode) {
         }
 
         // Menampilkan prompt jika tidak dalam mode batch
-        if (!batch_mode) {
-            printf("Ketik pesan (ketik 'exit' untuk keluar): ");
+        if (!batch_mode && show_prompt) {
+            printf("Ketik pesan (/join, /leave, /rooms, /msg, atau 'exit' untuk keluar): ");
             fflush(stdout);
+            show_prompt = 0;
         }
 
-        int activity = select(max_sd + 1, &readfds, NULL, NULL, NULL);
+        uint64_t now = now_ms();
+        if (ping_sent != 0 && now - ping_sent >= CLIENT_PONG_TIMEOUT_MS) {
+            printf("\nServer tidak merespons PING. Memutus koneksi...\n");
+            break;
+        }
+        if (ping_sent == 0 && now - last_recv >= CLIENT_PING_INTERVAL_MS) {
+            if (chat_send_frame(sock, FRAME_PING, &now, sizeof(now)) < 0) {
+                perror("Gagal mengirim PING");
+                break;
+            }
+            ping_sent = now;
+        }
+        uint64_t deadline = ping_sent != 0 ? ping_sent + CLIENT_PONG_TIMEOUT_MS : last_recv + CLIENT_PING_INTERVAL_MS;
+        uint64_t wait_ms = deadline > now ? deadline - now : 0;
+        struct timeval timeout = {(time_t)(wait_ms / 1000), (suseconds_t)(wait_ms % 1000) * 1000};
+
+        int activity = select(max_sd + 1, &readfds, NULL, NULL, &timeout);
 
         if (activity < 0) {
             perror("Error pada fungsi select");
             break;
         }
 
-        // Jika ada data dari server
+        // Jika ada data dari server. Satu read() bisa berisi beberapa frame
+        // sekaligus atau hanya sebagian frame, jadi semua lewat parser.
         if (FD_ISSET(sock, &readfds)) {
-            memset(buffer, 0, BUFFER_SIZE);
-            int bytes_received = read(sock, buffer, BUFFER_SIZE);
+            size_t space;
+            char *dst = chat_parser_write_ptr(&parser, &space);
+            if (dst == NULL) {
+                perror("Gagal memperbesar buffer penerima");
+                break;
+            }
+            ssize_t bytes_received = read(sock, dst, space);
             if (bytes_received <= 0) {
                 if (bytes_received == 0) {
-                    printf("Server menutup koneksi.\n");
+                    printf("\nServer menutup koneksi.\n");
                 } else {
                     perror("Gagal menerima pesan dari server");
                 }
                 break;
             }
-            printf("\nPesan dari server: %s\n", buffer);
+            chat_parser_commit(&parser, bytes_received);
+            // Data apa pun dari server membuktikan koneksi masih hidup
+            last_recv = now_ms();
+            ping_sent = 0;
+
+            struct chat_frame frame;
+            int rc;
+            int rejected = 0;
+            while ((rc = chat_parser_next(&parser, &frame)) == 1) {
+                if (frame.type == FRAME_REJECT) {
+                    // Server menolak koneksi (penuh atau terlalu banyak koneksi baru)
+                    const char *reason;
+                    size_t reason_len;
+                    if (chat_read_reject(&frame, retry_after_ms, &reason, &reason_len) == 0) {
+                        printf("\nKoneksi ditolak server: %.*s (coba lagi dalam %u ms)\n", (int)reason_len, reason, *retry_after_ms);
+                    }
+                    rejected = 1;
+                    break;
+                }
+                if (frame.type == FRAME_PING) {
+                    // Balas heartbeat server dengan data yang sama
+                    if (chat_send_frame(sock, FRAME_PONG, frame.payload, frame.length) < 0) {
+                        perror("Gagal mengirim PONG");
+                        rejected = 1;
+                        break;
+                    }
+                    continue;
+                }
+                if (frame.type == FRAME_PONG) {
+                    continue;
+                }
+                if (frame.type == FRAME_THROTTLE) {
+                    // Pesan terakhir dibuang server, koneksi tetap terbuka
+                    uint32_t retry_ms;
+                    const char *reason;
+                    size_t reason_len;
+                    if (chat_read_reject(&frame, &retry_ms, &reason, &reason_len) == 0) {
+                        printf("\nPesan dibatasi server: %.*s (tunggu %u ms)\n", (int)reason_len, reason, retry_ms);
+                        show_prompt = 1;
+                    }
+                    continue;
+                }
+                print_frame(&frame);
+                show_prompt = 1;
+            }
+            if (rejected) {
+                break;
+            }
+            if (rc < 0) {
+                printf("Frame dari server tidak valid. Memutus koneksi...\n");
+                break;
+            }
         }
 
         // Jika ada input dari pengguna
         if (!batch_mode && FD_ISSET(STDIN_FILENO, &readfds)) {
-            if (fgets(buffer, BUFFER_SIZE, stdin) == NULL) {
+            show_prompt = 1;
+            ssize_t line_len = getline(&line, &line_cap, stdin);
+            if (line_len < 0) {
                 if (feof(stdin)) {
                     printf("Input berakhir. Memutus koneksi...\n");
-                    break;
                 } else {
                     perror("Error membaca input");
-                    break;
                 }
+                result = CLIENT_EXIT;
+                break;
             }
 
             // Menghapus karakter newline
-            buffer[strcspn(buffer, "\n")] = '\0';
+            line[strcspn(line, "\n")] = '\0';
+            size_t message_len = strlen(line);
 
-            if (strlen(buffer) == 0) {
+            if (message_len == 0) {
                 printf("Pesan tidak boleh kosong.\n");
                 continue;
-            } else if (strlen(buffer) >= BUFFER_SIZE) {
-                printf("Pesan terlalu panjang. Maksimum %d karakter.\n", BUFFER_SIZE - 1);
+            } else if (message_len > CHAT_DEFAULT_MAX_PAYLOAD) {
+                printf("Pesan terlalu panjang. Maksimum %d karakter.\n", CHAT_DEFAULT_MAX_PAYLOAD);
                 continue;
             }
 
             // Jika pengguna mengetik 'exit', putus koneksi
-            if (strcmp(buffer, "exit") == 0) {
+            if (strcmp(line, "exit") == 0) {
                 printf("Memutus koneksi...\n");
+                result = CLIENT_EXIT;
+                break;
+            }
+
+            // Perintah room dan pesan pribadi
+            int command = send_command(sock, line);
+            if (command < 0) {
+                perror("Gagal mengirim perintah");
                 break;
+            } else if (command > 0) {
+                continue;
             }
 
-            // Mengirimkan pesan ke server
-            if (send(sock, buffer, strlen(buffer), 0) <= 0) {
+            // Mengirimkan pesan ke room aktif
+            if (chat_send_frame(sock, FRAME_CHAT, line, message_len) < 0) {
                 perror("Gagal mengirim pesan");
                 break;
             }
         }
     }
 
+    free(line);
+    chat_parser_free(&parser);
+
     // Memutus koneksi ke server
     shutdown(sock, SHUT_RDWR);
     close(sock);
+    return result;
+}
+
+// Menghubungkan ke server dan mengulang koneksi yang putus dengan exponential
+// backoff plus jitter, agar klien yang putus bersamaan tidak kembali serentak.
+// Saran waktu tunggu dari frame REJECT selalu dihormati.
+void run_client(const char *username, int batch_mode) {
+    uint32_t backoff_ms = RECONNECT_MIN_MS;
+    srand((unsigned int)(now_ms() ^ (uint64_t)getpid()));
+
+    while (1) {
+        int connected = 0;
+        uint32_t retry_after_ms = 0;
+        if (connect_to_server(username, batch_mode, &connected, &retry_after_ms) == CLIENT_EXIT) {
+            return;
+        }
+        if (connected && retry_after_ms == 0) {
+            backoff_ms = RECONNECT_MIN_MS; // Koneksi sempat berjalan normal
+        }
+
+        uint32_t delay_ms = backoff_ms / 2 + (uint32_t)rand() % (backoff_ms / 2 + 1);
+        if (delay_ms < retry_after_ms) {
+            delay_ms = retry_after_ms;
+        }
+        printf("Menghubungkan ulang dalam %u ms...\n", delay_ms);
+        fflush(stdout);
+        struct timespec delay = {(time_t)(delay_ms / 1000), (long)(delay_ms % 1000) * 1000000};
+        nanosleep(&delay, NULL);
+
+        backoff_ms = backoff_ms * 2 < RECONNECT_MAX_MS ? backoff_ms * 2 : RECONNECT_MAX_MS;
+    }
 }
 
 int main(int argc, char const *argv[]) {
@@ -174,6 +393,6 @@ int main(int argc, char const *argv[]) {
         batch_mode = 1; // Aktifkan mode batch jika ada argumen "batch"
     }
 
-    connect_to_server(argv[1], batch_mode);
+    run_client(argv[1], batch_mode);
     return 0;
 }